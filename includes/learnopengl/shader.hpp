@@ -52,54 +52,67 @@ class Shader {
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
     }
+    // the program is deleted with its owner; moved from shaders own none
+    // ------------------------------------------------------------------------
+    Shader(const Shader&)            = delete;
+    Shader& operator=(const Shader&) = delete;
+    Shader(Shader&& other) noexcept : ID{std::exchange(other.ID, 0)} {}
+    Shader& operator=(Shader&& other) noexcept {
+        std::swap(ID, other.ID);
+        return *this;
+    }
+    ~Shader() {
+        if (ID)
+            glDeleteProgram(ID);
+    }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() { glUseProgram(ID); }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void set(const std::string& name, bool value) const {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+    void set(const char* name, bool value) const {
+        glUniform1i(glGetUniformLocation(ID, name), (int)value);
     }
     // ------------------------------------------------------------------------
-    void set(const std::string& name, int value) const {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+    void set(const char* name, int value) const {
+        glUniform1i(glGetUniformLocation(ID, name), value);
     }
     // ------------------------------------------------------------------------
-    void set(const std::string& name, float value) const {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+    void set(const char* name, float value) const {
+        glUniform1f(glGetUniformLocation(ID, name), value);
     }
     // ------------------------------------------------------------------------
-    void set(const std::string& name, const glm::vec2& value) const {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    void set(const char* name, const glm::vec2& value) const {
+        glUniform2fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void set(const std::string& name, float x, float y) const {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+    void set(const char* name, float x, float y) const {
+        glUniform2f(glGetUniformLocation(ID, name), x, y);
     }
     // ------------------------------------------------------------------------
-    void set(const std::string& name, const glm::vec3& value) const {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    void set(const char* name, const glm::vec3& value) const {
+        glUniform3fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void set(const std::string& name, float x, float y, float z) const {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+    void set(const char* name, float x, float y, float z) const {
+        glUniform3f(glGetUniformLocation(ID, name), x, y, z);
     }
     // ------------------------------------------------------------------------
-    void set(const std::string& name, const glm::vec4& value) const {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+    void set(const char* name, const glm::vec4& value) const {
+        glUniform4fv(glGetUniformLocation(ID, name), 1, &value[0]);
     }
-    void set(const std::string& name, float x, float y, float z, float w) {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+    void set(const char* name, float x, float y, float z, float w) {
+        glUniform4f(glGetUniformLocation(ID, name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
-    void set(const std::string& name, const glm::mat2& mat) const {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    void set(const char* name, const glm::mat2& mat) const {
+        glUniformMatrix2fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void set(const std::string& name, const glm::mat3& mat) const {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    void set(const char* name, const glm::mat3& mat) const {
+        glUniformMatrix3fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void set(const std::string& name, const glm::mat4& mat) const {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+    void set(const char* name, const glm::mat4& mat) const {
+        glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, &mat[0][0]);
     }
 
   private:
@@ -1,5 +1,11 @@
 #version 330 core
-layout(location = 0) in vec3 aPos;
+layout(location = 0) in float aHeight;
+
+uniform int grid_width;
+uniform vec2 grid_origin;
+uniform vec2 tile_origin;
+uniform float tile_size;
+uniform sampler2D quantization;
 
 uniform mat4 grid_model;
 uniform mat4 cursor_model;
@@ -9,9 +15,18 @@ uniform mat4 projection;
 out vec3 gridPosition;
 out vec3 cursorPosition;
 
+// Vertex i sits at column i % grid_width and row i / grid_width, with its height quantised over
+// the tile it lies in.
+vec3 gridVertex() {
+    vec2 cell = vec2(gl_VertexID % grid_width, gl_VertexID / grid_width);
+    vec2 tile = texelFetch(quantization, ivec2(floor((cell + tile_origin) / tile_size)), 0).rg;
+    return vec3(grid_origin.x + cell.x, tile.x + aHeight * tile.y, grid_origin.y + cell.y);
+}
+
 void main() {
-    gl_Position    = projection * view * grid_model * vec4(aPos, 1.0);
-    gridPosition   = vec3(grid_model * vec4(aPos, 1.0));
+    vec3 vertex    = gridVertex();
+    gl_Position    = projection * view * grid_model * vec4(vertex, 1.0);
+    gridPosition   = vec3(grid_model * vec4(vertex, 1.0));
     gridPosition.y = 0;
     cursorPosition = vec3(cursor_model * vec4(vec3(0.0), 1.0));
 }
\ No newline at end of file
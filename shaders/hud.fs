@@ -0,0 +1,12 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D font;
+
+in vec2 texel;
+in vec4 color;
+
+void main() {
+    float coverage = texelFetch(font, ivec2(texel), 0).r;
+    FragColor      = vec4(color.rgb, color.a * coverage);
+}
@@ -0,0 +1,16 @@
+#version 330 core
+layout(location = 0) in vec2 aPosition;
+layout(location = 1) in vec2 aTexel;
+layout(location = 2) in vec4 aColor;
+
+// Positions are in pixels from the top-left corner.
+uniform vec2 screen_size;
+
+out vec2 texel;
+out vec4 color;
+
+void main() {
+    gl_Position = vec4(aPosition / screen_size * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);
+    texel       = aTexel;
+    color       = aColor;
+}
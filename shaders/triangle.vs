@@ -1,10 +1,24 @@
 #version 330 core
-layout(location = 0) in vec3 aPos;
+layout(location = 0) in float aHeight;
+
+uniform int grid_width;
+uniform vec2 grid_origin;
+uniform vec2 tile_origin;
+uniform float tile_size;
+uniform sampler2D quantization;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Vertex i sits at column i % grid_width and row i / grid_width, with its height quantised over
+// the tile it lies in.
+vec3 gridVertex() {
+    vec2 cell = vec2(gl_VertexID % grid_width, gl_VertexID / grid_width);
+    vec2 tile = texelFetch(quantization, ivec2(floor((cell + tile_origin) / tile_size)), 0).rg;
+    return vec3(grid_origin.x + cell.x, tile.x + aHeight * tile.y, grid_origin.y + cell.y);
+}
+
 void main() {
-    gl_Position = projection * view * vec4(aPos, 1.0);
+    gl_Position = projection * view * vec4(gridVertex(), 1.0);
 }
\ No newline at end of file
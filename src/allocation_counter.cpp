@@ -0,0 +1,146 @@
+#include "allocation_counter.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace {
+thread_local AllocationCount thread_count{};
+std::atomic<uint64_t> total_allocations{0};
+std::atomic<uint64_t> total_bytes{0};
+std::atomic<int64_t> heap_bytes{0};
+
+void count(size_t bytes) {
+    thread_count.allocations++;
+    thread_count.bytes += bytes;
+    total_allocations.fetch_add(1, std::memory_order_relaxed);
+    total_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+// Follows the size of live blocks by asking the allocator on both allocation and free, which also
+// covers the deletes that are not passed a size.
+void track(void* pointer, int64_t sign) {
+#if defined(__GLIBC__)
+    if (pointer)
+        heap_bytes.fetch_add(
+            sign * int64_t(malloc_usable_size(pointer)), std::memory_order_relaxed);
+#endif
+}
+
+void* allocate(size_t bytes) {
+    count(bytes);
+    auto pointer = std::malloc(bytes ? bytes : 1);
+    track(pointer, 1);
+    return pointer;
+}
+
+void deallocate(void* pointer) {
+    track(pointer, -1);
+    std::free(pointer);
+}
+
+void* allocate(size_t bytes, std::align_val_t alignment) {
+    count(bytes);
+    const auto align = std::max(size_t(alignment), sizeof(void*));
+#ifdef _WIN32
+    return _aligned_malloc(bytes ? bytes : 1, align);
+#else
+    // aligned_alloc wants a multiple of the alignment.
+    auto pointer =
+        std::aligned_alloc(align, (std::max<size_t>(bytes, 1) + align - 1) / align * align);
+    track(pointer, 1);
+    return pointer;
+#endif
+}
+
+void release(void* pointer, std::align_val_t) {
+#ifdef _WIN32
+    _aligned_free(pointer);
+#else
+    deallocate(pointer);
+#endif
+}
+} // namespace
+
+AllocationCount ThreadAllocations() { return thread_count; }
+
+AllocationCount TotalAllocations() {
+    return {
+        total_allocations.load(std::memory_order_relaxed),
+        total_bytes.load(std::memory_order_relaxed)};
+}
+
+size_t HeapBytes() {
+    return size_t(std::max<int64_t>(heap_bytes.load(std::memory_order_relaxed), 0));
+}
+
+void* operator new(size_t bytes) {
+    if (auto pointer = allocate(bytes))
+        return pointer;
+    throw std::bad_alloc{};
+}
+
+void* operator new[](size_t bytes) { return operator new(bytes); }
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept { return allocate(bytes); }
+
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept { return allocate(bytes); }
+
+void* operator new(size_t bytes, std::align_val_t alignment) {
+    if (auto pointer = allocate(bytes, alignment))
+        return pointer;
+    throw std::bad_alloc{};
+}
+
+void* operator new[](size_t bytes, std::align_val_t alignment) {
+    return operator new(bytes, alignment);
+}
+
+void* operator new(size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(bytes, alignment);
+}
+
+void* operator new[](size_t bytes, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(bytes, alignment);
+}
+
+void operator delete(void* pointer) noexcept { deallocate(pointer); }
+
+void operator delete[](void* pointer) noexcept { deallocate(pointer); }
+
+void operator delete(void* pointer, size_t) noexcept { deallocate(pointer); }
+
+void operator delete[](void* pointer, size_t) noexcept { deallocate(pointer); }
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { deallocate(pointer); }
+
+void operator delete(void* pointer, std::align_val_t alignment) noexcept {
+    release(pointer, alignment);
+}
+
+void operator delete[](void* pointer, std::align_val_t alignment) noexcept {
+    release(pointer, alignment);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t alignment) noexcept {
+    release(pointer, alignment);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t alignment) noexcept {
+    release(pointer, alignment);
+}
+
+void operator delete(void* pointer, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    release(pointer, alignment);
+}
+
+void operator delete[](void* pointer, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    release(pointer, alignment);
+}
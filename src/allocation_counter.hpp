@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Counts the allocations made through the global operator new, which this module replaces.
+//
+// Memory the C library, GLFW or the GL driver get from malloc directly is not counted. Counting
+// is always on; it costs a thread-local and an atomic increment per allocation, and with glibc a
+// malloc_usable_size call and an atomic add per allocation and free to follow the live heap.
+struct AllocationCount {
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+// Allocations by the calling thread since it started.
+AllocationCount ThreadAllocations();
+// Allocations by every thread since the program started.
+AllocationCount TotalAllocations();
+// Bytes allocated through operator new and not yet freed, as the allocator rounded them; 0 where
+// the C library cannot tell the size of a block.
+size_t HeapBytes();
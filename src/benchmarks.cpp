@@ -0,0 +1,558 @@
+#include "benchmarks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/camera.hpp>
+#include <learnopengl/shader.hpp>
+
+#include "allocation_counter.hpp"
+#include "editor.hpp"
+#include "gl_state.hpp"
+#include "huge_pages.hpp"
+#include "mouse.hpp"
+#include "tile_codec.hpp"
+#include "tile_file.hpp"
+#include "tile_io.hpp"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+auto percentile(std::vector<double>& values, double fraction) {
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(std::size(values) - 1, size_t(fraction * std::size(values)))];
+}
+
+void dropPageCache(const std::filesystem::path& path) {
+#if !defined(_WIN32) && defined(POSIX_FADV_DONTNEED)
+    if (auto fd = ::open(path.c_str(), O_RDONLY); fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        ::close(fd);
+    }
+#endif
+}
+
+// Data TLB load misses of the calling thread, where perf events are available.
+class TlbMisses {
+  public:
+    TlbMisses() {
+#ifdef __linux__
+        perf_event_attr attr{};
+        attr.size   = sizeof(attr);
+        attr.type   = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                      | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        fd_                 = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    TlbMisses(const TlbMisses&)            = delete;
+    TlbMisses& operator=(const TlbMisses&) = delete;
+    ~TlbMisses() {
+#ifdef __linux__
+        if (fd_ >= 0)
+            ::close(fd_);
+#endif
+    }
+
+    void start() {
+#ifdef __linux__
+        if (fd_ >= 0) {
+            ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    // The misses since start(), or -1 if they cannot be counted.
+    int64_t stop() {
+#ifdef __linux__
+        uint64_t misses;
+        if (fd_ >= 0 && ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0) == 0
+            && ::read(fd_, &misses, sizeof(misses)) == sizeof(misses))
+            return int64_t(misses);
+#endif
+        return -1;
+    }
+
+  private:
+    int fd_ = -1;
+};
+
+// Anonymous memory of this process backed by transparent huge pages, in KiB.
+size_t anonHugePages() {
+    std::ifstream smaps{"/proc/self/smaps_rollup"};
+    for (std::string line; std::getline(smaps, line);) {
+        if (line.starts_with("AnonHugePages:"))
+            return std::strtoull(line.c_str() + line.find(':') + 1, nullptr, 10);
+    }
+    return 0;
+}
+
+// Runs full-map kernels over a map in `heights`: a horizontal and a vertical 3-tap blur, and brush
+// stamps at random positions. The vertical pass touches a new 4 KiB page on every sample.
+template <typename Heights>
+void runMapKernels(const char* name, Heights& heights, Heights& out, uint32_t size) {
+    constexpr auto Stamps = 2048;
+    constexpr auto Radius = 48;
+
+    TlbMisses tlb;
+    auto report = [&](const char* kernel, Clock::time_point start, size_t samples) {
+        const auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        const auto misses  = tlb.stop();
+        std::cout << name << " " << kernel << ": " << seconds * 1e3 << " ms, "
+                  << double(samples) * sizeof(float) / (1 << 30) / seconds << " GiB/s, dTLB misses "
+                  << (misses < 0 ? std::string{"n/a"} : std::to_string(misses)) << std::endl;
+    };
+
+    tlb.start();
+    auto start = Clock::now();
+    for (auto y = size_t{}; y < size; y++) {
+        const auto row = y * size;
+        for (auto x = size_t{1}; x + 1 < size; x++)
+            out[row + x] = (heights[row + x - 1] + heights[row + x] + heights[row + x + 1]) / 3.f;
+    }
+    report("rows", start, size_t(size) * size);
+
+    tlb.start();
+    start = Clock::now();
+    for (auto x = size_t{}; x < size; x++) {
+        for (auto y = size_t{1}; y + 1 < size; y++) {
+            const auto i = y * size + x;
+            out[i]       = (heights[i - size] + heights[i] + heights[i + size]) / 3.f;
+        }
+    }
+    report("columns", start, size_t(size) * size);
+
+    std::mt19937 random{5};
+    std::uniform_int_distribution<uint32_t> position{Radius, size - Radius - 1};
+    tlb.start();
+    start = Clock::now();
+    for (auto stamp = 0; stamp < Stamps; stamp++) {
+        const auto cx = position(random);
+        const auto cy = position(random);
+        for (auto y = cy - Radius; y <= cy + Radius; y++) {
+            for (auto x = cx - Radius; x <= cx + Radius; x++) {
+                const auto dx = int(x) - int(cx);
+                const auto dy = int(y) - int(cy);
+                if (dx * dx + dy * dy <= Radius * Radius)
+                    heights[size_t(y) * size + x] += 0.01f;
+            }
+        }
+    }
+    report("stamps", start, size_t(Stamps) * (2 * Radius + 1) * (2 * Radius + 1));
+}
+
+// Compares full-map kernels over default std::vector storage and huge page backed storage, and
+// the cost of first touching a new map with and without prefaulting.
+int hugePages(int count, char* args[]) {
+    auto size = 8192u;
+    for (auto i = 0; i < count; i++) {
+        if (std::string_view{args[i]} == "--size" && i + 1 < count)
+            size = std::max(256, std::atoi(args[++i]));
+    }
+    const auto samples = size_t(size) * size;
+    std::cout << size << "x" << size << " map, " << (samples * sizeof(float) >> 20) << " MiB"
+              << std::endl;
+
+    auto touch = [&](const char* name, float* heights) {
+        const auto start = Clock::now();
+        std::fill_n(heights, samples, 1.0f);
+        std::cout << name << " first touch: "
+                  << std::chrono::duration<double, std::milli>(Clock::now() - start).count()
+                  << " ms" << std::endl;
+    };
+
+    {
+        std::vector<float> heights(samples, 1.0f);
+        std::vector<float> out(samples);
+        runMapKernels("4 KiB pages", heights, out, size);
+    }
+    {
+        const auto before = anonHugePages();
+        HugePageVector<float> heights(samples, 1.0f);
+        HugePageVector<float> out(samples);
+        std::cout << "huge pages: " << (anonHugePages() - before) / 1024 << " MiB of "
+                  << (2 * samples * sizeof(float) >> 20) << " MiB transparently backed"
+                  << std::endl;
+        runMapKernels("huge pages", heights, out, size);
+    }
+
+    const auto bytes = samples * sizeof(float);
+    for (auto prefault : {false, true}) {
+        const auto start = Clock::now();
+        auto heights     = static_cast<float*>(AllocateHugePages(bytes, prefault));
+        if (!heights)
+            return -1;
+        std::cout << (prefault ? "huge pages, prefaulted" : "huge pages") << " allocation: "
+                  << std::chrono::duration<double, std::milli>(Clock::now() - start).count()
+                  << " ms" << std::endl;
+        touch(prefault ? "huge pages, prefaulted" : "huge pages", heights);
+        FreeHugePages(heights, bytes);
+    }
+    {
+        auto heights = std::make_unique_for_overwrite<float[]>(samples);
+        touch("4 KiB pages", heights.get());
+    }
+    return 0;
+}
+
+// Reads every tile of the map in random order, `passes` times, keeping QueueDepth reads in
+// flight, and reports throughput and per-tile latency from submission to completion.
+int tileIO(int count, char* args[]) {
+    constexpr size_t QueueDepth = 32;
+    constexpr uint32_t MapSize  = 8192;
+
+    auto path   = std::filesystem::path{"tile_io_bench.tvhm"};
+    auto direct = false;
+    auto passes = 3;
+    for (auto i = 0; i < count; i++) {
+        if (auto arg = std::string_view{args[i]}; arg == "--direct")
+            direct = true;
+        else if (arg == "--passes" && i + 1 < count)
+            passes = std::max(1, std::atoi(args[++i]));
+        else
+            path = arg;
+    }
+
+    if (!std::filesystem::exists(path)) {
+        std::cout << "Creating " << MapSize << "x" << MapSize << " map at " << path.string()
+                  << std::endl;
+        HugePageVector<float> heights(size_t(MapSize) * MapSize);
+        std::mt19937 random{42};
+        std::uniform_real_distribution<float> distribution{-10.f, 10.f};
+        for (auto& height : heights)
+            height = distribution(random);
+        if (!TileFile::Create(path, MapSize, MapSize, std::data(heights)))
+            return -1;
+    }
+
+    TileFile file;
+    if (!file.open(path, false))
+        return -1;
+
+    const auto bytes = (file.getTileBytes() + TileIO::Alignment - 1) / TileIO::Alignment
+                       * TileIO::Alignment;
+    std::vector<uint64_t> tiles;
+    for (auto ty = 0u; ty < file.getTilesY(); ty++)
+        for (auto tx = 0u; tx < file.getTilesX(); tx++)
+            tiles.push_back(file.getTileOffset(tx, ty));
+
+    std::vector<TileIO::Buffer> buffers;
+    for (auto i = size_t{}; i < QueueDepth; i++)
+        buffers.push_back(TileIO::AllocateBuffer(bytes));
+
+    for (auto backend : {TileIO::Backend::Pread, TileIO::Backend::IoUring}) {
+        auto io = TileIO::Create(file, backend, direct);
+        if (io->getBackend() != backend)
+            continue;
+
+        std::mt19937 random{7};
+        std::vector<double> latencies;
+        std::vector<Clock::time_point> submitted(QueueDepth);
+        std::vector<TileIO::Request> completed;
+        auto failures = size_t{};
+
+        if (!io->isDirect())
+            dropPageCache(path);
+        const auto start = Clock::now();
+        for (auto pass = 0; pass < passes; pass++) {
+            std::shuffle(tiles.begin(), tiles.end(), random);
+            auto next = size_t{};
+            for (auto slot = size_t{}; slot < QueueDepth && next < std::size(tiles); slot++) {
+                submitted[slot] = Clock::now();
+                io->submit({slot, tiles[next++], buffers[slot].get(), bytes, false, 0});
+            }
+            while (io->getInFlight() > 0) {
+                completed.clear();
+                io->wait(completed, 1);
+                const auto now = Clock::now();
+                for (auto& request : completed) {
+                    failures += request.result < 0;
+                    latencies.push_back(
+                        std::chrono::duration<double, std::micro>(now - submitted[request.key])
+                            .count());
+                    if (next < std::size(tiles)) {
+                        submitted[request.key] = Clock::now();
+                        io->submit(
+                            {request.key, tiles[next++], request.buffer, bytes, false, 0});
+                    }
+                }
+            }
+        }
+        const auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        const auto reads = std::size(latencies);
+        std::cout << TileIO::GetName(backend) << (io->isDirect() ? " (O_DIRECT)" : "") << ": "
+                  << reads << " tiles, " << double(reads * bytes) / (1 << 20) / seconds
+                  << " MiB/s, " << reads / seconds << " tiles/s, latency us p50 "
+                  << percentile(latencies, 0.5) << " p99 " << percentile(latencies, 0.99)
+                  << " p99.9 " << percentile(latencies, 0.999) << " max "
+                  << percentile(latencies, 1.0) << (failures ? " FAILURES " : "")
+                  << (failures ? std::to_string(failures) : "") << std::endl;
+    }
+    return 0;
+}
+
+// Compresses and decompresses every tile of the map, checks the round trip and reports the
+// compression ratio and codec throughput. Constant tiles are skipped.
+int tileCodec(int count, char* args[]) {
+    constexpr uint32_t MapSize = 4096;
+
+    auto path = std::filesystem::path{"tile_codec_bench.tvhm"};
+    if (count > 0)
+        path = args[0];
+
+    if (!std::filesystem::exists(path)) {
+        std::cout << "Creating " << MapSize << "x" << MapSize << " terrain at " << path.string()
+                  << std::endl;
+        HugePageVector<float> heights(size_t(MapSize) * MapSize);
+        for (auto y = 0u; y < MapSize; y++) {
+            for (auto x = 0u; x < MapSize; x++) {
+                heights[size_t(y) * MapSize + x] =
+                    6.0f * std::sin(x * 0.002f) * std::cos(y * 0.003f)
+                    + 2.0f * std::sin(x * 0.013f + y * 0.007f)
+                    + 0.3f * std::sin(x * 0.11f) * std::sin(y * 0.09f);
+            }
+        }
+        if (!TileFile::Create(path, MapSize, MapSize, std::data(heights)))
+            return -1;
+    }
+
+    TileFile file;
+    if (!file.open(path, false))
+        return -1;
+
+    const auto tile_size = file.getTileSize();
+    std::vector<float> samples(size_t(tile_size) * tile_size);
+    std::vector<float> decoded(std::size(samples));
+    std::vector<uint8_t> compressed;
+    auto tiles            = size_t{};
+    auto compressed_bytes = size_t{};
+    auto mismatches       = size_t{};
+    auto compress_seconds = 0.0;
+    auto decode_seconds   = 0.0;
+    for (auto ty = 0u; ty < file.getTilesY(); ty++) {
+        for (auto tx = 0u; tx < file.getTilesX(); tx++) {
+            if (file.isConstant(tx, ty))
+                continue;
+            file.readTile(tx, ty, std::data(samples));
+            const auto start = Clock::now();
+            CompressTile(std::data(samples), tile_size, compressed);
+            const auto compressed_at = Clock::now();
+            const auto valid         = DecompressTile(
+                std::data(compressed), std::size(compressed), tile_size, std::data(decoded));
+            const auto decoded_at = Clock::now();
+
+            compress_seconds += std::chrono::duration<double>(compressed_at - start).count();
+            decode_seconds += std::chrono::duration<double>(decoded_at - compressed_at).count();
+            mismatches += !valid
+                          || std::memcmp(
+                                 std::data(samples),
+                                 std::data(decoded),
+                                 std::size(samples) * sizeof(float))
+                                 != 0;
+            compressed_bytes += std::size(compressed);
+            tiles++;
+        }
+    }
+
+    const auto bytes = double(tiles) * std::size(samples) * sizeof(float);
+    std::cout << tiles << " tiles, ratio " << (compressed_bytes ? bytes / compressed_bytes : 0.0)
+              << ", compress " << bytes / (1 << 20) / compress_seconds << " MiB/s, decompress "
+              << bytes / (1 << 20) / decode_seconds << " MiB/s"
+              << (mismatches ? " MISMATCHES " : "")
+              << (mismatches ? std::to_string(mismatches) : "") << std::endl;
+    return mismatches ? -1 : 0;
+}
+
+// Drives a real Editor in a hidden window the way main() does: mouse events go through a
+// Mouse::StateMachine wired like main's, whose movement moves the brush along a circle inside the
+// view and whose scroll raises and lowers it within one long stroke, and every frame is updated,
+// drawn and swapped. Once the tiles are resident and the stroke has touched all of them, no frame
+// may allocate.
+int frameAllocations(int, char*[]) {
+    constexpr uint32_t MapSize   = 1024;
+    constexpr uint32_t TileSize  = 64;
+    constexpr int Warmup         = 600;
+    constexpr int Frames         = 2000;
+    constexpr float DeltaTime    = 1.0f / 60.0f;
+    constexpr float CursorSpeed  = 0.03f;
+    constexpr float BrushRadius  = 6.0f;
+    constexpr float CircleRadius = 100.0f;
+    // Movement events per frame, and the angle the brush moves on by in each.
+    constexpr int Movements      = 4;
+    constexpr float AngleStep    = 6.2831853f / 1200.0f;
+
+    const auto path = std::filesystem::temp_directory_path() / "frame_allocations_bench.tvhm";
+    std::vector<float> map(size_t(MapSize) * MapSize);
+    for (auto i = size_t{}; i < std::size(map); i++)
+        map[i] = 4.0f * std::sin(i % MapSize * 0.01f) * std::cos(i / MapSize * 0.013f);
+    if (!TileFile::Create(
+            path, MapSize, MapSize, std::data(map), TileFile::Format::Float32, TileSize)) {
+        return -1;
+    }
+    const auto journal = std::filesystem::path{path}.concat(".journal");
+    std::error_code error;
+    std::filesystem::remove(journal, error);
+
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    auto window = glfwCreateWindow(800, 600, "Frame allocations", nullptr, nullptr);
+    if (window)
+        glfwMakeContextCurrent(window);
+    if (!window || !gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cout << "ERROR::BENCHMARK::NO_GL_CONTEXT" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwSwapInterval(0);
+    InstallGLStateCache();
+    glEnable(GL_DEPTH_TEST);
+
+    auto allocating_frames = 0;
+    auto max_allocations   = uint64_t{};
+    auto seconds           = 0.0;
+    {
+        Editor editor(path, Cursor{CursorSpeed, {0.79f, 0.071f, 0.13f}, BrushRadius});
+        editor.waitUntilLoaded();
+        Camera camera({0.0f, 3.0f, 10.0f}, {0.0f, 1.0f, 0.0f}, -90.f, -20.0f);
+        Shader cursor_shader("shaders/cursor.vs", "shaders/cursor.fs");
+        Shader triangle_shader("shaders/triangle.vs", "shaders/default.fs");
+        Shader wireframe_shader(
+            "shaders/wireframe.vs", "shaders/default.fs", "shaders/wireframe.gs");
+        const auto projection =
+            glm::perspective(glm::radians(camera.Zoom), 4.0f / 3.0f, 0.1f, 100.0f);
+        for (auto shader : {&cursor_shader, &triangle_shader, &wireframe_shader}) {
+            shader->use();
+            shader->set("projection", projection);
+            shader->set("view", camera.GetViewMatrix());
+        }
+
+        Mouse::StateMachine mouse;
+        mouse.add(Mouse::State::Default, Mouse::Action::LeftPress, Mouse::State::LeftPressed, [&] {
+            editor.beginStroke();
+        });
+        mouse.add(
+            Mouse::State::LeftPressed, Mouse::Action::LeftRelease, Mouse::State::Default, [&] {
+                editor.endStroke();
+                editor.reset();
+            });
+        for (auto [action, increment] :
+             {std::pair{Mouse::Action::ScrollUp, 0.01f}, {Mouse::Action::ScrollDown, -0.01f}}) {
+            mouse.add(
+                Mouse::State::LeftPressed, action, Mouse::State::LeftPressed, [&, increment] {
+                    editor.increment(increment);
+                    editor.set();
+                });
+        }
+        mouse.add<float, float>(
+            Mouse::State::LeftPressed,
+            Mouse::Action::Movement,
+            Mouse::State::LeftPressed,
+            [&](auto xoffset, auto zoffset) {
+                editor.updateCursor(xoffset, zoffset);
+                editor.set();
+            });
+
+        auto brush = glm::vec2{};
+        auto frame = [&](int index) {
+            editor.update(camera, DeltaTime);
+            for (auto movement = 0; movement < Movements; movement++) {
+                const auto angle  = float(index * Movements + movement) * AngleStep;
+                const auto target = CircleRadius * glm::vec2{std::cos(angle), std::sin(angle)};
+                // Cursor offsets are scaled by its speed, and z runs against the mouse's y.
+                const auto offset = (target - brush) / CursorSpeed;
+                mouse.execute(Mouse::Action::Movement, offset.x, -offset.y);
+                brush = target;
+            }
+            if (index % 8 == 0)
+                mouse.execute(index % 16 ? Mouse::Action::ScrollDown : Mouse::Action::ScrollUp);
+            glClearColor(0.0f, 0.0f, 0.5f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            editor.draw(triangle_shader, wireframe_shader, cursor_shader);
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        };
+
+        mouse.execute(Mouse::Action::LeftPress);
+        for (auto index = 0; index < Warmup; index++)
+            frame(index);
+        auto allocations = ThreadAllocations().allocations;
+        const auto start = Clock::now();
+        for (auto index = Warmup; index < Warmup + Frames; index++) {
+            frame(index);
+            const auto total = ThreadAllocations().allocations;
+            allocating_frames += total > allocations;
+            max_allocations = std::max(max_allocations, total - allocations);
+            allocations     = total;
+        }
+        seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        mouse.execute(Mouse::Action::LeftRelease);
+        std::cout << allocating_frames << " of " << Frames << " frames allocated (at most "
+                  << max_allocations << " allocations), " << seconds / Frames * 1e6
+                  << " us per frame, " << editor.getRenderStats().dabs << " dabs" << std::endl;
+    }
+    glfwTerminate();
+    std::filesystem::remove(journal, error);
+    std::filesystem::remove(path, error);
+    return allocating_frames ? -1 : 0;
+}
+} // namespace
+
+int RunBenchmark(int count, char* args[]) {
+    const auto benchmarks = std::unordered_map<std::string_view, int (*)(int, char*[])>{
+        {"tile-io", tileIO},
+        {"tile-codec", tileCodec},
+        {"huge-pages", hugePages},
+        {"frame-allocations", frameAllocations},
+    };
+    if (count > 0) {
+        if (auto found = benchmarks.find(args[0]); found != std::end(benchmarks))
+            return found->second(count - 1, args + 1);
+    }
+    std::cout << "Available benchmarks:";
+    for (auto& [name, benchmark] : benchmarks)
+        std::cout << " " << name;
+    std::cout << std::endl;
+    return -1;
+}
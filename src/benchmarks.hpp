@@ -0,0 +1,10 @@
+#pragma once
+
+// Runs the benchmark named by args[0] with the remaining arguments; returns the exit code.
+//
+//   tile-io [path] [--direct] [--passes N]   pread vs io_uring tile throughput and latency
+//   tile-codec [path]                        in-memory tile compression ratio and throughput
+//   huge-pages [--size N]                    full-map kernels on 4 KiB vs huge pages
+//   frame-allocations                        fails if steady painting frames allocate; needs a
+//                                            GL 3.3 context in a hidden window
+int RunBenchmark(int count, char* args[]);
@@ -0,0 +1,91 @@
+#include "buffer_pool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+BufferPool::Range::Range(Range&& other) noexcept
+  : pool_{std::exchange(other.pool_, nullptr)}, block_{other.block_}, offset_{other.offset_},
+    size_{std::exchange(other.size_, 0)} {}
+
+BufferPool::Range& BufferPool::Range::operator=(Range&& other) noexcept {
+    std::swap(pool_, other.pool_);
+    std::swap(block_, other.block_);
+    std::swap(offset_, other.offset_);
+    std::swap(size_, other.size_);
+    return *this;
+}
+
+BufferPool::Range::~Range() {
+    if (pool_)
+        pool_->release(block_, offset_, size_);
+}
+
+GLuint BufferPool::Range::getBuffer() const {
+    return pool_ ? pool_->blocks_[block_].buffer.get() : 0;
+}
+
+void BufferPool::Range::upload(const void* data, size_t bytes, size_t offset) const {
+    // The copy target leaves the vertex array and element bindings alone.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, getBuffer());
+    glBufferSubData(GL_COPY_WRITE_BUFFER, offset_ + offset, bytes, data);
+}
+
+BufferPool::BufferPool(size_t block_size, GLenum usage)
+  : block_size_{block_size}, usage_{usage} {}
+
+BufferPool::Range BufferPool::allocate(size_t bytes) {
+    const auto size = std::max((bytes + Alignment - 1) / Alignment * Alignment, Alignment);
+    for (auto block = size_t{}; block < std::size(blocks_); block++) {
+        auto& free = blocks_[block].free;
+        for (auto found = free.begin(); found != free.end(); ++found) {
+            auto [offset, available] = *found;
+            if (available < size)
+                continue;
+            free.erase(found);
+            if (available > size)
+                free.emplace(offset + size, available - size);
+            used_bytes_ += size;
+            ranges_++;
+            return {this, block, offset, size};
+        }
+    }
+
+    const auto block_size = std::max(block_size_, size);
+    auto buffer           = Buffer::Create();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer.get());
+    glBufferData(GL_COPY_WRITE_BUFFER, block_size, nullptr, usage_);
+    auto& block = blocks_.emplace_back(Block{std::move(buffer), block_size, {}});
+    if (block_size > size)
+        block.free.emplace(size, block_size - size);
+    used_bytes_ += size;
+    ranges_++;
+    return {this, std::size(blocks_) - 1, 0, size};
+}
+
+void BufferPool::release(size_t block, size_t offset, size_t size) {
+    used_bytes_ -= size;
+    ranges_--;
+    auto& free = blocks_[block].free;
+    auto next  = free.lower_bound(offset);
+    if (next != free.end() && offset + size == next->first) {
+        size += next->second;
+        next = free.erase(next);
+    }
+    if (next != free.begin()) {
+        if (auto previous = std::prev(next); previous->first + previous->second == offset) {
+            previous->second += size;
+            return;
+        }
+    }
+    free.emplace_hint(next, offset, size);
+}
+
+BufferPool::Stats BufferPool::getStats() const {
+    Stats stats{std::size(blocks_), 0, used_bytes_, ranges_, 0};
+    for (auto& block : blocks_) {
+        stats.capacity_bytes += block.size;
+        for (auto& [offset, size] : block.free)
+            stats.largest_free_bytes = std::max(stats.largest_free_bytes, size);
+    }
+    return stats;
+}
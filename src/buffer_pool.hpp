@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+#include "gl_object.hpp"
+
+// Sub-allocates vertex and index data from a few large GL buffers, so meshes are created and
+// destroyed without going through the driver's allocator.
+//
+// Ranges are taken first fit from blocks of block_size bytes, and a request no block can hold
+// opens a new block of at least its size. Freed ranges merge with their free neighbours. The pool
+// must outlive its ranges.
+class BufferPool {
+  public:
+    static constexpr size_t DefaultBlockSize = size_t{16} << 20;
+    // Offsets suit every vertex attribute and index type.
+    static constexpr size_t Alignment = 16;
+
+    struct Stats {
+        size_t blocks;
+        size_t capacity_bytes;
+        size_t used_bytes;
+        size_t ranges;
+        size_t largest_free_bytes;
+    };
+
+    // A range of one of the pool's buffers, returned to the pool on destruction.
+    class Range {
+      public:
+        Range() = default;
+        Range(Range&& other) noexcept;
+        Range& operator=(Range&& other) noexcept;
+        ~Range();
+
+        GLuint getBuffer() const;
+        size_t getOffset() const { return offset_; }
+        size_t getSize() const { return size_; }
+
+        // Copies `bytes` to `offset` within the range.
+        void upload(const void* data, size_t bytes, size_t offset = 0) const;
+
+      private:
+        friend class BufferPool;
+        Range(BufferPool* pool, size_t block, size_t offset, size_t size)
+          : pool_{pool}, block_{block}, offset_{offset}, size_{size} {}
+
+        BufferPool* pool_ = nullptr;
+        size_t block_     = 0;
+        size_t offset_    = 0;
+        size_t size_      = 0;
+    };
+
+    explicit BufferPool(size_t block_size = DefaultBlockSize, GLenum usage = GL_DYNAMIC_DRAW);
+    BufferPool(const BufferPool&)            = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    Range allocate(size_t bytes);
+
+    Stats getStats() const;
+
+  private:
+    struct Block {
+        Buffer buffer;
+        size_t size;
+        // Free ranges by offset.
+        std::map<size_t, size_t> free;
+    };
+
+    void release(size_t block, size_t offset, size_t size);
+
+    size_t block_size_;
+    GLenum usage_;
+    std::vector<Block> blocks_;
+    size_t used_bytes_ = 0;
+    size_t ranges_     = 0;
+};
@@ -10,7 +10,8 @@
 
 #include <learnopengl/shader.hpp>
 
-Circle::Circle(uint32_t slices, float radius) {
+Circle::Circle(uint32_t slices, float radius)
+  : VAO{VertexArray::Create()}, VBO{Buffer::Create()}, EBO{Buffer::Create()} {
     std::vector<glm::vec3> vertices;
 
     const auto step = 360.f / slices;
@@ -26,22 +27,16 @@ Circle::Circle(uint32_t slices, float radius) {
     std::iota(indices.begin(), indices.end(), 0);
     indices.push_back(1);
 
-    glGenVertexArrays(1, &VAO);
+    glBindVertexArray(VAO.get());
 
-    glGenBuffers(1, &VBO);
-
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
     glBufferData(
         GL_ARRAY_BUFFER,
         std::size(vertices) * sizeof(glm::vec3),
         std::data(vertices),
         GL_STATIC_DRAW);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.get());
     glBufferData(
         GL_ELEMENT_ARRAY_BUFFER,
         std::size(indices) * sizeof(uint32_t),
@@ -55,6 +50,6 @@ Circle::Circle(uint32_t slices, float radius) {
 }
 
 void Circle::draw() const {
-    glBindVertexArray(VAO);
+    glBindVertexArray(VAO.get());
     glDrawElements(GL_TRIANGLE_FAN, count, GL_UNSIGNED_INT, nullptr);
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include <cstdint>
 
+#include "gl_object.hpp"
+
 class Shader;
 
 class Circle {
@@ -11,7 +13,7 @@ class Circle {
 
   private:
     uint32_t count;
-    uint32_t VAO;
-    uint32_t VBO;
-    uint32_t EBO;
+    VertexArray VAO;
+    Buffer VBO;
+    Buffer EBO;
 };
\ No newline at end of file
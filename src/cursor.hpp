@@ -1,5 +1,9 @@
 #pragma once
 
+#include <utility>
+
+#include <glm/glm.hpp>
+
 class Cursor {
   public:
     explicit Cursor(float speed, glm::vec3 color, float radius)
@@ -10,10 +14,14 @@ class Cursor {
         position_.z += (-zoffset * speed_);
     }
 
+    void setPosition(glm::vec3 position) { position_ = position; }
+
     auto getPosition() const { return position_; }
 
     auto getColor() const { return color_; }
 
+    void setRadius(float radius) { radius_ = radius; }
+
     auto getRadius() const { return radius_; }
 
   private:
@@ -0,0 +1,484 @@
+#include "editor.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <tuple>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/camera.hpp>
+#include <learnopengl/shader.hpp>
+
+#include "metrics.hpp"
+#include "profiler.hpp"
+#include "scratch_map.hpp"
+
+Editor::Editor(
+    std::filesystem::path path, Cursor cursor, size_t cache_budget, size_t history_budget)
+  : Editor(path, DefaultSize, DefaultSize, cursor, cache_budget, history_budget) {}
+
+Editor::Editor(
+    uint32_t width, uint32_t height, Cursor cursor, size_t cache_budget, size_t history_budget)
+  : Editor({}, width, height, cursor, cache_budget, history_budget) {}
+
+Editor::Editor(
+    const std::filesystem::path& path,
+    uint32_t width,
+    uint32_t height,
+    Cursor cursor,
+    size_t cache_budget,
+    size_t history_budget)
+  : file_{openMap(path, width, height)}, width_{file_.getWidth()}, height_{file_.getHeight()},
+    cursor_{cursor},
+    cache_{file_, cache_budget}, prefetcher_{cache_, MaxViewSize / 2.f},
+    layers_{cache_},
+    history_{
+        file_.getTileSize(),
+        [this](auto tx, auto ty) { return layers_.find(LayerStack::Sculpt, tx, ty); },
+        [this](auto tx, auto ty) { return layers_.edit(LayerStack::Sculpt, tx, ty); },
+        UniqueTemporaryPath(file_.getPath().stem().string(), ".history"),
+        history_budget},
+    view_width_{std::min(width_, MaxViewSize)}, view_height_{std::min(height_, MaxViewSize)},
+    view_x_{(width_ - view_width_) / 2}, view_y_{(height_ - view_height_) / 2},
+    loading_{std::async(std::launch::async, [this] { load(); })} {}
+
+Editor::~Editor() { loading_.wait(); }
+
+TileFile Editor::openMap(const std::filesystem::path& path, uint32_t width, uint32_t height) {
+    TileFile file;
+    if (!path.empty() && file.open(path))
+        return file;
+    const auto untitled = claimUntitled();
+    if (untitled.empty() || !TileFile::Create(untitled, width, height, nullptr)
+        || !file.open(untitled)) {
+        std::cout << "ERROR::EDITOR::NO_MAP " << untitled.string() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return file;
+}
+
+std::filesystem::path Editor::claimUntitled() {
+    const auto directory = std::filesystem::temp_directory_path();
+    for (auto i = 1; i <= MaxUntitled; i++) {
+        auto path =
+            directory / (i == 1 ? "untitled.tvhm" : "untitled-" + std::to_string(i) + ".tvhm");
+        if (untitled_.tryLock(path))
+            return path;
+    }
+    return {};
+}
+
+glm::vec2 Editor::toSample(glm::vec3 position) const {
+    return {position.x + width_ / 2.f - 0.5f, position.z + height_ / 2.f - 0.5f};
+}
+
+void Editor::placeCursor(glm::vec2 sample, float radius) {
+    const auto position = cursor_.getPosition();
+    cursor_.setPosition(
+        {sample.x - width_ / 2.f + 0.5f, position.y, sample.y - height_ / 2.f + 0.5f});
+    cursor_.setRadius(radius);
+}
+
+void Editor::set() {
+    PROFILE_ZONE("Editor::set");
+    if (!finishLoading(true))
+        return;
+    static auto& latency = GlobalMetrics().histogram(
+        "brush_dab_seconds", "Brush applications, from editing the layer to uploading the mesh");
+
+    const auto start     = std::chrono::steady_clock::now();
+    const auto center    = toSample(cursor_.getPosition());
+    const auto radius    = cursor_.getRadius();
+    const auto tile_size = int(file_.getTileSize());
+
+    const auto x0 = std::max(0, int(std::ceil(center.x - radius)));
+    const auto y0 = std::max(0, int(std::ceil(center.y - radius)));
+    const auto x1 = std::min(int(width_) - 1, int(std::floor(center.x + radius)));
+    const auto y1 = std::min(int(height_) - 1, int(std::floor(center.y + radius)));
+    if (x0 > x1 || y0 > y1)
+        return;
+
+    // Brush edits outside a stroke are undone on their own.
+    const auto implicit = !history_.isRecording();
+    if (implicit)
+        history_.begin();
+
+    auto first_row = view_height_;
+    auto last_row  = 0u;
+    for (auto ty = y0 / tile_size; ty <= y1 / tile_size; ty++) {
+        for (auto tx = x0 / tile_size; tx <= x1 / tile_size; tx++) {
+            const auto tile_x0 = std::max(x0, tx * tile_size);
+            const auto tile_y0 = std::max(y0, ty * tile_size);
+            const auto tile_x1 = std::min(x1 + 1, (tx + 1) * tile_size);
+            const auto tile_y1 = std::min(y1 + 1, (ty + 1) * tile_size);
+            const auto dirty   = LayerStack::Rect{
+                tile_x0 - tx * tile_size,
+                tile_y0 - ty * tile_size,
+                tile_x1 - tx * tile_size,
+                tile_y1 - ty * tile_size};
+            auto samples = layers_.edit(LayerStack::Sculpt, tx, ty, dirty);
+            history_.record(tx, ty, samples);
+            stroke_tiles_.insert(TileKey(tx, ty));
+            for (auto y = tile_y0; y < tile_y1; y++) {
+                for (auto x = tile_x0; x < tile_x1; x++) {
+                    if (glm::length(glm::vec2(x, y) - center) <= radius)
+                        samples[(y - ty * tile_size) * tile_size + x - tx * tile_size] = value_;
+                }
+            }
+
+            // Layers above the sculpt layer and its opacity decide what the mesh shows.
+            const auto [first, last] = quantizeTile(tx, ty, layers_.read(tx, ty), dirty);
+            if (first < last) {
+                first_row = std::min(first_row, first);
+                last_row  = std::max(last_row, last);
+            }
+        }
+    }
+    if (first_row < last_row) {
+        render_stats_.uploaded_bytes += grid_->update(
+            heights_,
+            first_row,
+            last_row,
+            quantization_,
+            view_tiles_x_,
+            upload_ring_,
+            frame_arena_);
+    }
+    render_stats_.dabs++;
+    if (implicit) {
+        history_.commit();
+        refitStroke();
+    }
+    latency.record(std::chrono::steady_clock::now() - start);
+}
+
+void Editor::beginStroke() {
+    if (!finishLoading(true))
+        return;
+    stroking_ = true;
+    history_.begin();
+}
+
+void Editor::endStroke() {
+    if (!finishLoading(true))
+        return;
+    stroking_ = false;
+    history_.commit();
+    refitStroke();
+}
+
+void Editor::undo() {
+    if (!finishLoading(true))
+        return;
+    if (history_.undo())
+        reloadView();
+}
+
+void Editor::redo() {
+    if (!finishLoading(true))
+        return;
+    if (history_.redo())
+        reloadView();
+}
+
+void Editor::toggleLayer(size_t layer) {
+    if (!finishLoading(true))
+        return;
+    layers_.setVisible(layer, !layers_.isVisible(layer));
+    reloadView();
+}
+
+void Editor::update(const Camera& camera, float delta_time) {
+    PROFILE_ZONE("Editor::update");
+    if (!finishLoading(false))
+        return;
+    frame_arena_.reset();
+    upload_ring_.nextFrame();
+    const auto position      = toSample(camera.Position);
+    const auto camera_sample = glm::vec3{position.x, camera.Position.y, position.y};
+    prefetcher_.update(
+        delta_time,
+        camera_sample,
+        camera.Yaw,
+        camera.Pitch,
+        toSample(cursor_.getPosition()),
+        cursor_.getRadius(),
+        stroking_);
+    cache_.update();
+    layers_.update();
+    // A stroke in progress is checkpointed once it ends.
+    if (!stroking_)
+        journal_->update(delta_time);
+
+    const auto focus = TilePrefetcher::Focus(camera_sample, camera.Yaw, camera.Pitch);
+    const auto x     = uint32_t(
+        std::clamp(int(focus.x) - int(view_width_ / 2), 0, int(width_ - view_width_)));
+    const auto y = uint32_t(
+        std::clamp(int(focus.y) - int(view_height_ / 2), 0, int(height_ - view_height_)));
+    if (std::abs(int(x) - int(view_x_)) > int(view_width_ / 4)
+        || std::abs(int(y) - int(view_y_)) > int(view_height_ / 4)) {
+        view_x_ = x;
+        view_y_ = y;
+        reloadView();
+    }
+}
+
+void Editor::draw(Shader& triangle_shader, Shader& wireframe_shader, Shader& cursor_shader) {
+    PROFILE_ZONE("Editor::draw");
+    if (!grid_)
+        return;
+    gpu_timer_.beginFrame();
+    gpu_timer_.begin("Solid");
+    triangle_shader.use();
+    setGridUniforms(triangle_shader);
+    triangle_shader.set("color", glm::vec3{1.0f});
+    triangle_shader.set("model", glm::mat4(1.0f));
+    grid_->draw();
+
+    gpu_timer_.begin("Wireframe");
+    wireframe_shader.use();
+    setGridUniforms(wireframe_shader);
+    wireframe_shader.set("color", glm::vec3{0.0f});
+    wireframe_shader.set("model", glm::translate(glm::mat4(1.0f), glm::vec3(0.0, 0.006, 0.0)));
+    grid_->draw();
+
+    gpu_timer_.begin("Cursor");
+    glDepthFunc(GL_ALWAYS);
+    cursor_shader.use();
+    setGridUniforms(cursor_shader);
+    cursor_shader.set("color", cursor_.getColor());
+    cursor_shader.set("radius", cursor_.getRadius());
+    cursor_shader.set("grid_model", glm::mat4(1.0f));
+    cursor_shader.set("cursor_model", glm::translate(glm::mat4(1.0f), cursor_.getPosition()));
+    grid_->draw();
+    glDepthFunc(GL_LESS);
+    gpu_timer_.end();
+    render_stats_.draw_calls += 3 * grid_->getDrawCalls();
+    render_stats_.triangles += 3 * grid_->getTriangles();
+}
+
+Editor::MemoryStats Editor::getMemoryStats() const {
+    loading_.wait();
+    const auto layers     = layers_.getStats();
+    const auto tile_bytes = size_t(file_.getTileSize()) * file_.getTileSize() * sizeof(float);
+    return {
+        heights_.capacity() * sizeof(uint16_t) + quantization_.capacity() * sizeof(Quantization),
+        (layers.layer_tiles + layers.composite_tiles) * tile_bytes,
+        history_.getStats().memory_bytes,
+        cache_.getStats().resident_bytes,
+        frame_arena_.getCapacity(),
+        grid_ ? grid_->getBufferBytes() : 0,
+        grid_ ? grid_->getTextureBytes() : 0,
+        buffer_pool_.getStats().capacity_bytes,
+        upload_ring_.getSize()};
+}
+
+void Editor::setGridUniforms(const Shader& shader) const {
+    const auto tile_size = file_.getTileSize();
+    shader.set("grid_width", int(view_width_));
+    shader.set("grid_origin", 0.5f - (width_ / 2.f) + view_x_, 0.5f - (height_ / 2.f) + view_y_);
+    shader.set("tile_origin", float(view_x_ % tile_size), float(view_y_ % tile_size));
+    shader.set("tile_size", float(tile_size));
+    shader.set("quantization", 0);
+}
+
+void Editor::save(std::filesystem::path path) {
+    if (!finishLoading(true))
+        return;
+    cache_.flush();
+    file_.flush();
+    // Editing continues while the snapshot is baked; see LayerStack. Constant tiles of the result
+    // take no space in the exported file.
+    std::thread{[source = file_.getPath(), path = std::move(path), layers = layers_.snapshot()] {
+        PROFILE_THREAD("Export");
+        PROFILE_ZONE("Editor::save");
+        TileFile base;
+        if (!base.open(source, false)
+            || !TileFile::Create(
+                path,
+                base.getWidth(),
+                base.getHeight(),
+                nullptr,
+                base.getFormat(),
+                base.getTileSize(),
+                base.getMinHeight(),
+                base.getMaxHeight())) {
+            std::cout << "ERROR::EDITOR::EXPORT_FAILED " << path.string() << std::endl;
+            return;
+        }
+        TileFile file;
+        if (!file.open(path))
+            return;
+        const auto tile_size = layers.tile_size;
+        const auto keys      = layers.getKeys();
+        std::vector<float> samples(size_t(tile_size) * tile_size);
+        std::vector<float> composite(std::size(samples));
+        auto stored = size_t{};
+        for (auto ty = 0u; ty < file.getTilesY(); ty++) {
+            for (auto tx = 0u; tx < file.getTilesX(); tx++) {
+                base.readTile(tx, ty, std::data(samples));
+                if (std::binary_search(keys.begin(), keys.end(), TileKey(tx, ty))) {
+                    layers.composite(
+                        TileKey(tx, ty),
+                        std::data(samples),
+                        std::data(composite),
+                        {0, 0, tile_size, tile_size});
+                    samples.swap(composite);
+                }
+                file.writeTile(tx, ty, std::data(samples));
+                stored += !file.isConstant(tx, ty);
+            }
+        }
+        file.flush();
+        std::cout << "Sucessfully exported to " << path.string() << " (" << stored << " of "
+                  << file.getTilesX() * file.getTilesY() << " tiles stored)" << std::endl;
+    }}.detach();
+}
+
+uint64_t Editor::getHeightHash() {
+    if (!finishLoading(true))
+        return 0;
+    const auto tile_bytes = size_t(file_.getTileSize()) * file_.getTileSize() * sizeof(float);
+    auto hash             = uint64_t{0xcbf29ce484222325};
+    for (auto ty = 0u; ty < file_.getTilesY(); ty++) {
+        for (auto tx = 0u; tx < file_.getTilesX(); tx++) {
+            const auto bytes = reinterpret_cast<const uint8_t*>(layers_.read(tx, ty));
+            for (auto i = size_t{}; i < tile_bytes; i++)
+                hash = (hash ^ bytes[i]) * 0x100000001b3;
+        }
+    }
+    return hash;
+}
+
+std::pair<uint32_t, uint32_t> Editor::quantizeTile(
+    uint32_t tx, uint32_t ty, const float* samples, LayerStack::Rect rect) {
+    const auto tile_size = int(file_.getTileSize());
+    const auto view      = LayerStack::Rect{
+        std::max(int(view_x_) - int(tx) * tile_size, 0),
+        std::max(int(view_y_) - int(ty) * tile_size, 0),
+        std::min(int(view_x_ + view_width_) - int(tx) * tile_size, tile_size),
+        std::min(int(view_y_ + view_height_) - int(ty) * tile_size, tile_size)};
+    rect = {
+        std::max(rect.x0, view.x0),
+        std::max(rect.y0, view.y0),
+        std::min(rect.x1, view.x1),
+        std::min(rect.y1, view.y1)};
+    if (rect.x0 >= rect.x1 || rect.y0 >= rect.y1)
+        return {};
+
+    auto range = [&](LayerStack::Rect rect) {
+        auto min = std::numeric_limits<float>::infinity();
+        auto max = -min;
+        for (auto y = rect.y0; y < rect.y1; y++) {
+            const auto row         = samples + size_t(y) * tile_size;
+            const auto [low, high] = std::minmax_element(row + rect.x0, row + rect.x1);
+            min                    = std::min(min, *low);
+            max                    = std::max(max, *high);
+        }
+        return std::pair{min, max};
+    };
+    const auto tile    = (ty - view_y_ / tile_size) * view_tiles_x_ + tx - view_x_ / tile_size;
+    auto& quantization = quantization_[tile];
+    const auto whole   = rect.x0 == view.x0 && rect.y0 == view.y0 && rect.x1 == view.x1
+                       && rect.y1 == view.y1;
+    if (auto [min, max] = range(rect); whole || !quantization.contains(min, max)) {
+        if (!whole)
+            std::tie(min, max) = range(view);
+        rect         = view;
+        quantization = Quantization::Fit(min, max);
+    }
+
+    for (auto y = rect.y0; y < rect.y1; y++) {
+        Quantize(
+            samples + size_t(y) * tile_size + rect.x0,
+            rect.x1 - rect.x0,
+            quantization,
+            std::data(heights_) + size_t(int(ty) * tile_size + y - int(view_y_)) * view_width_
+                + int(tx) * tile_size + rect.x0 - int(view_x_));
+    }
+    const auto row = int(ty) * tile_size - int(view_y_);
+    return {uint32_t(row + rect.y0), uint32_t(row + rect.y1)};
+}
+
+void Editor::quantizeView() {
+    const auto tile_size = file_.getTileSize();
+    const auto tx0       = view_x_ / tile_size;
+    const auto ty0       = view_y_ / tile_size;
+    const auto tx1       = (view_x_ + view_width_ - 1) / tile_size;
+    const auto ty1       = (view_y_ + view_height_ - 1) / tile_size;
+    view_tiles_x_        = tx1 - tx0 + 1;
+    heights_.resize(size_t(view_width_) * view_height_);
+    quantization_.assign(size_t(view_tiles_x_) * (ty1 - ty0 + 1), {});
+    for (auto ty = ty0; ty <= ty1; ty++) {
+        for (auto tx = tx0; tx <= tx1; tx++)
+            quantizeTile(tx, ty, layers_.read(tx, ty), LayerStack::Full);
+    }
+}
+
+void Editor::refitStroke() {
+    PROFILE_ZONE("Editor::refitStroke");
+    auto first_row = view_height_;
+    auto last_row  = 0u;
+    for (auto key : stroke_tiles_) {
+        const auto tx            = uint32_t(key);
+        const auto ty            = uint32_t(key >> 32);
+        const auto [first, last] = quantizeTile(tx, ty, layers_.read(tx, ty), LayerStack::Full);
+        if (first < last) {
+            first_row = std::min(first_row, first);
+            last_row  = std::max(last_row, last);
+        }
+    }
+    stroke_tiles_.clear();
+    if (first_row < last_row) {
+        render_stats_.uploaded_bytes += grid_->update(
+            heights_,
+            first_row,
+            last_row,
+            quantization_,
+            view_tiles_x_,
+            upload_ring_,
+            frame_arena_);
+    }
+}
+
+void Editor::load() {
+    PROFILE_THREAD("Loader");
+    PROFILE_ZONE("Editor::load");
+    journal_.emplace(std::filesystem::path{file_.getPath()}.concat(".journal"), layers_);
+    quantizeView();
+    indices_ = Grid::GenerateIndices(view_width_, view_height_);
+}
+
+bool Editor::finishLoading(bool wait) {
+    if (grid_)
+        return true;
+    if (load_failed_
+        || (!wait && loading_.wait_for(std::chrono::seconds{0}) != std::future_status::ready))
+        return false;
+    PROFILE_ZONE("Editor::finishLoading");
+    // Rethrows what load() threw; a failed load leaves the editor without a mesh for good.
+    try {
+        loading_.get();
+    } catch (const std::exception& error) {
+        std::cout << "ERROR::EDITOR::LOAD_FAILED " << file_.getPath().string() << ": "
+                  << error.what() << std::endl;
+        load_failed_ = true;
+        return false;
+    }
+    grid_.emplace(
+        buffer_pool_, view_width_, view_height_, heights_, quantization_, view_tiles_x_, indices_);
+    indices_ = {};
+    return true;
+}
+
+void Editor::reloadView() {
+    PROFILE_ZONE("Editor::reloadView");
+    quantizeView();
+    render_stats_.uploaded_bytes += grid_->update(
+        heights_, 0, view_height_, quantization_, view_tiles_x_, upload_ring_, frame_arena_);
+}
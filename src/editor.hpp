@@ -2,33 +2,98 @@
 
 #include <algorithm>
 #include <filesystem>
+#include <future>
+#include <optional>
 #include <thread>
+#include <unordered_set>
+#include <utility>
 
+#include "buffer_pool.hpp"
 #include "cursor.hpp"
+#include "file_lock.hpp"
+#include "frame_arena.hpp"
+#include "gpu_timer.hpp"
 #include "grid.hpp"
+#include "history.hpp"
+#include "journal.hpp"
+#include "layer_stack.hpp"
+#include "tile_cache.hpp"
+#include "tile_file.hpp"
+#include "tile_prefetcher.hpp"
+#include "upload_ring.hpp"
+
+class Camera;
+class Shader;
 
 class Editor {
   public:
-    Editor(uint32_t width, uint32_t height, Cursor cursor)
-      : width_{width}, height_{height}, cursor_{cursor}, vertices_{Grid::GenerateVertices(
-                                                             width,
-                                                             height)},
-        grid_{width, height, vertices_, Grid::GenerateIndices(width, height)} {}
+    static constexpr size_t DefaultCacheBudget = size_t{256} << 20;
+    // The rendered mesh covers at most this many samples per side around the camera focus.
+    static constexpr uint32_t MaxViewSize = 512;
+    // Size of the untitled map that replaces a map that fails to open.
+    static constexpr uint32_t DefaultSize = 256;
+    // Untitled maps that can be open at once, one per editor.
+    static constexpr int MaxUntitled = 64;
+
+    // Running totals since the editor started.
+    struct RenderStats {
+        uint64_t draw_calls     = 0;
+        uint64_t triangles      = 0;
+        uint64_t uploaded_bytes = 0;
+        // Brush applications.
+        uint64_t dabs           = 0;
+    };
+
+    // Bytes each subsystem holds right now.
+    struct MemoryStats {
+        // The view's quantised heights and tile quantisation.
+        size_t heights;
+        // Layer and composited tiles.
+        size_t layers;
+        size_t history;
+        size_t tile_cache;
+        size_t frame_arena;
+        // GPU: the mesh's ranges of the buffer pool, its quantisation texture, the pool's blocks
+        // and the upload ring. These are computed from the sizes requested, not read back from
+        // the driver, so they miss its padding and copies.
+        size_t mesh_buffers;
+        size_t mesh_texture;
+        size_t buffer_pool;
+        size_t upload_ring;
+
+        size_t cpu() const { return heights + layers + history + tile_cache + frame_arena; }
+        size_t gpu() const { return mesh_texture + buffer_pool + upload_ring; }
+    };
+
+    Editor(
+        std::filesystem::path path,
+        Cursor cursor,
+        size_t cache_budget   = DefaultCacheBudget,
+        size_t history_budget = History::DefaultBudget);
+
+    // Starts a flat, untitled map in the temporary directory; see claimUntitled().
+    Editor(
+        uint32_t width,
+        uint32_t height,
+        Cursor cursor,
+        size_t cache_budget   = DefaultCacheBudget,
+        size_t history_budget = History::DefaultBudget);
+    ~Editor();
+
+    // The map loads on a worker thread: the journal is replayed and the view read and quantised
+    // while the caller goes on, e.g. compiling shaders and drawing frames. Until the mesh exists
+    // update() and draw() do nothing; the other calls that need the map wait for it. If loading
+    // fails, the error is reported once and those calls keep doing nothing.
+    bool isLoaded() const { return grid_.has_value(); }
+    bool hasLoadFailed() const { return load_failed_; }
+    // Returns whether the map loaded.
+    bool waitUntilLoaded() { return finishLoading(true); }
 
     auto updateCursor(float xoffset, float zoffset) { cursor_.updatePosition(xoffset, zoffset); }
+    // Centres the brush on a map sample, for scripted edits.
+    void placeCursor(glm::vec2 sample, float radius);
 
-    void set() {
-        for (auto& vertex_position : vertices_) {
-            auto y            = vertex_position.y;
-            vertex_position.y = {};
-            if (auto diff = glm::length(cursor_.getPosition() - vertex_position);
-                diff <= cursor_.getRadius()) {
-                y = value_;
-            }
-            vertex_position.y = y;
-        }
-        grid_ = {width_, height_, vertices_, Grid::GenerateIndices(width_, height_)};
-    }
+    void set();
 
     void increment(float increment) {
         value_ += increment;
@@ -38,40 +103,113 @@ class Editor {
 
     void reset() { value_ = {}; }
 
-    auto draw(Shader triangle_shader, Shader wireframe_shader, Shader cursor_shader) {
-        triangle_shader.use();
-        triangle_shader.set("color", glm::vec3{1.0f});
-        triangle_shader.set("model", glm::mat4(1.0f));
-        grid_.draw();
-
-        wireframe_shader.use();
-        wireframe_shader.set("color", glm::vec3{0.0f});
-        wireframe_shader.set("model", glm::translate(glm::mat4(1.0f), glm::vec3(0.0, 0.006, 0.0)));
-        grid_.draw();
-
-        glDepthFunc(GL_ALWAYS);
-        cursor_shader.use();
-        cursor_shader.set("color", cursor_.getColor());
-        cursor_shader.set("radius", cursor_.getRadius());
-        cursor_shader.set("grid_model", glm::mat4(1.0f));
-        cursor_shader.set("cursor_model", glm::translate(glm::mat4(1.0f), cursor_.getPosition()));
-        grid_.draw();
-        glDepthFunc(GL_LESS);
-    }
+    void beginStroke();
+    void endStroke();
+
+    void undo();
+    void redo();
 
-    void save(std::filesystem::path path) {
-        std::thread{[path = std::move(path)] {
-            std::cout << "Sucessfully exported to " << path.string() << std::endl;
-        }}.detach();
+    void toggleLayer(size_t layer);
+
+    // Starts a frame: creates the mesh if the map just finished loading, releases the frame's
+    // scratch memory, prefetches tiles ahead of the camera and the cursor, recentres the rendered
+    // mesh and checkpoints the journal.
+    void update(const Camera& camera, float delta_time);
+
+    void draw(Shader& triangle_shader, Shader& wireframe_shader, Shader& cursor_shader);
+
+    // Exports the map with every visible layer baked into the base.
+    void save(std::filesystem::path path);
+    // FNV-1a hash of the composited heights of the whole map, to check that a replayed session
+    // ends where the recorded one did.
+    uint64_t getHeightHash();
+
+    auto getCacheStats() const {
+        loading_.wait();
+        return cache_.getStats();
+    }
+    auto getPrefetchStats() const { return prefetcher_.getStats(); }
+    auto getHistoryStats() const { return history_.getStats(); }
+    auto getLayerStats() const {
+        loading_.wait();
+        return layers_.getStats();
     }
+    auto getJournalStats() const {
+        loading_.wait();
+        return journal_ ? journal_->getStats() : Journal::Stats{};
+    }
+    auto getBufferStats() const { return buffer_pool_.getStats(); }
+    auto getUploadStats() const { return upload_ring_.getStats(); }
+    const GpuTimer& getGpuTimer() const { return gpu_timer_; }
+    const RenderStats& getRenderStats() const { return render_stats_; }
+    MemoryStats getMemoryStats() const;
 
   private:
+    // Opens `path`, or a new untitled map of the given size if there is none or it fails to open.
+    Editor(
+        const std::filesystem::path& path,
+        uint32_t width,
+        uint32_t height,
+        Cursor cursor,
+        size_t cache_budget,
+        size_t history_budget);
+
+    TileFile openMap(const std::filesystem::path& path, uint32_t width, uint32_t height);
+    // Locks the first untitled map in the temporary directory that no other editor holds. The
+    // lock dies with a crashed session, so the next untitled editor replays its journal.
+    std::filesystem::path claimUntitled();
+
+    glm::vec2 toSample(glm::vec3 position) const;
+    // Requantises the tile's part of the view within the tile-local `rect` from its composite
+    // `samples`, refitting the tile's quantisation to its whole part of the view if `rect` covers
+    // it or the new heights fall outside the current range. Returns the first and one past the
+    // last view row it changed.
+    std::pair<uint32_t, uint32_t> quantizeTile(
+        uint32_t tx, uint32_t ty, const float* samples, LayerStack::Rect rect);
+    // Requantises every tile in view.
+    void quantizeView();
+    // Refits the tiles the stroke edited to their current range, which dabs only ever widen.
+    void refitStroke();
+    // Runs on the loading thread, which has the layers, the cache and the view to itself.
+    void load();
+    // Creates the mesh once loading finished; returns whether it exists.
+    bool finishLoading(bool wait);
+    void reloadView();
+    void setGridUniforms(const Shader& shader) const;
+
+    FileLock untitled_;
+    TileFile file_;
     uint32_t width_;
     uint32_t height_;
     Cursor cursor_;
-    std::vector<glm::vec3> vertices_;
-    Grid grid_;
-    float value_ = 0.0f;
-    float max_   = 10.f;
-    float min_   = -10.f;
-};
\ No newline at end of file
+    TileCache cache_;
+    TilePrefetcher prefetcher_;
+    LayerStack layers_;
+    History history_;
+    // Created by load(), which replays it.
+    std::optional<Journal> journal_;
+    uint32_t view_width_;
+    uint32_t view_height_;
+    uint32_t view_x_;
+    uint32_t view_y_;
+    // The view's heights as 16-bit codes, quantised per tile; see Grid.
+    std::vector<uint16_t> heights_;
+    std::vector<Quantization> quantization_;
+    uint32_t view_tiles_x_;
+    // Keys of the tiles edited since the last refitStroke().
+    std::unordered_set<uint64_t> stroke_tiles_;
+    FrameArena frame_arena_;
+    BufferPool buffer_pool_;
+    UploadRing upload_ring_;
+    GpuTimer gpu_timer_;
+    // Indices of the mesh, generated by load().
+    std::vector<uint32_t> indices_;
+    std::optional<Grid> grid_;
+    RenderStats render_stats_;
+    float value_      = 0.0f;
+    float max_        = 10.f;
+    float min_        = -10.f;
+    bool stroking_    = false;
+    bool load_failed_ = false;
+    std::shared_future<void> loading_;
+};
@@ -0,0 +1,111 @@
+#include "editor_metrics.hpp"
+
+#include "allocation_counter.hpp"
+#include "gl_state.hpp"
+
+EditorMetrics::EditorMetrics(MetricsRegistry& registry)
+  : frame_seconds_{registry.histogram("frame_seconds", "Frame times")},
+    gpu_frame_seconds_{registry.gauge("gpu_frame_seconds", "GPU time of the last measured frame")},
+    draw_calls_{registry.counter("draw_calls_total", "Draw calls submitted")},
+    triangles_{registry.counter("triangles_total", "Triangles submitted")},
+    gl_state_calls_{registry.counter("gl_state_calls_total", "GL state changes requested")},
+    gl_state_elided_{
+        registry.counter("gl_state_elided_total", "Redundant GL state changes not sent")},
+    dabs_{registry.counter("brush_dabs_total", "Brush applications")},
+    history_strokes_{registry.gauge("history_strokes", "Strokes that can be undone or redone")},
+    history_bytes_{registry.gauge("history_memory_bytes", "Memory held by the undo history")},
+    layer_tiles_{registry.gauge("layer_tiles", "Tiles held by the edit layers")},
+    journal_checkpoints_{registry.counter("journal_checkpoints_total", "Journal checkpoints")},
+    journal_bytes_{registry.gauge("journal_bytes", "Size of the edit journal")},
+    resident_tiles_{registry.gauge("tile_cache_resident_tiles", "Tiles in the tile cache")},
+    resident_bytes_{registry.gauge("tile_cache_resident_bytes", "Memory held by the tile cache")},
+    compressed_bytes_{
+        registry.gauge("tile_cache_compressed_bytes", "Memory held by compressed cached tiles")},
+    cache_hits_{registry.counter("tile_cache_hits_total", "Tile accesses served by the cache")},
+    cache_misses_{registry.counter("tile_cache_misses_total", "Tile accesses read synchronously")},
+    tile_loads_{registry.counter("tile_loads_total", "Tiles loaded asynchronously")},
+    tile_evictions_{registry.counter("tile_evictions_total", "Tiles evicted from the cache")},
+    prefetch_issued_{registry.counter("prefetch_issued_total", "Tile prefetches issued")},
+    prefetch_stall_frames_{registry.counter(
+        "prefetch_stall_frames_total", "Frames that read at least one tile synchronously")},
+    uploaded_bytes_{registry.counter("uploaded_bytes_total", "Bytes uploaded to the mesh")},
+    upload_overflows_{registry.counter(
+        "upload_ring_overflows_total", "Uploads that did not fit into the upload ring")},
+    buffer_blocks_{registry.gauge("gpu_buffer_blocks", "Blocks of the GPU buffer pool")},
+    buffer_capacity_bytes_{
+        registry.gauge("gpu_buffer_capacity_bytes", "Size of the GPU buffer pool")},
+    buffer_used_bytes_{
+        registry.gauge("gpu_buffer_used_bytes", "GPU buffer pool memory handed out")},
+    buffer_ranges_{registry.gauge("gpu_buffer_ranges", "Live GPU buffer pool ranges")},
+    heights_bytes_{registry.gauge("heights_bytes", "Memory held by the view's quantised heights")},
+    layers_bytes_{registry.gauge("layers_bytes", "Memory held by layer and composited tiles")},
+    frame_arena_bytes_{registry.gauge("frame_arena_bytes", "Size of the frame arena")},
+    mesh_texture_bytes_{registry.gauge(
+        "gpu_mesh_texture_bytes", "Estimated GPU memory of the mesh's quantisation texture")},
+    upload_ring_bytes_{registry.gauge("gpu_upload_ring_bytes", "Size of the GPU upload ring")},
+    gl_buffers_{registry.gauge("gl_buffers", "Live GL buffer objects")},
+    gl_vertex_arrays_{registry.gauge("gl_vertex_arrays", "Live GL vertex array objects")},
+    gl_textures_{registry.gauge("gl_textures", "Live GL texture objects")},
+    allocations_{registry.counter("heap_allocations_total", "Heap allocations by any thread")},
+    allocated_bytes_{
+        registry.counter("heap_allocated_bytes_total", "Bytes allocated on the heap")},
+    heap_bytes_{registry.gauge("heap_bytes", "Heap memory allocated and not yet freed")} {}
+
+void EditorMetrics::sample(const Editor& editor, float frame_seconds) {
+    frame_seconds_.recordSeconds(frame_seconds);
+    auto gpu_ms = 0.0;
+    for (auto& pass : editor.getGpuTimer().getPasses())
+        gpu_ms += pass.last_ms;
+    gpu_frame_seconds_.set(gpu_ms / 1000.0);
+    const auto& render = editor.getRenderStats();
+    draw_calls_.set(render.draw_calls);
+    triangles_.set(render.triangles);
+    const auto gl_state = GetGLStateStats();
+    gl_state_calls_.set(gl_state.calls);
+    gl_state_elided_.set(gl_state.elided);
+    dabs_.set(render.dabs);
+    uploaded_bytes_.set(render.uploaded_bytes);
+
+    const auto history = editor.getHistoryStats();
+    history_strokes_.set(double(history.strokes));
+    history_bytes_.set(double(history.memory_bytes));
+    layer_tiles_.set(double(editor.getLayerStats().layer_tiles));
+    const auto journal = editor.getJournalStats();
+    journal_checkpoints_.set(journal.checkpoints);
+    journal_bytes_.set(double(journal.bytes));
+
+    const auto cache = editor.getCacheStats();
+    resident_tiles_.set(double(cache.resident_tiles));
+    resident_bytes_.set(double(cache.resident_bytes));
+    compressed_bytes_.set(double(cache.compressed_bytes));
+    cache_hits_.set(cache.hits);
+    cache_misses_.set(cache.misses);
+    tile_loads_.set(cache.loads);
+    tile_evictions_.set(cache.evictions);
+    const auto prefetch = editor.getPrefetchStats();
+    prefetch_issued_.set(prefetch.issued);
+    prefetch_stall_frames_.set(prefetch.stall_frames);
+
+    upload_overflows_.set(editor.getUploadStats().overflows);
+    const auto buffers = editor.getBufferStats();
+    buffer_blocks_.set(double(buffers.blocks));
+    buffer_capacity_bytes_.set(double(buffers.capacity_bytes));
+    buffer_used_bytes_.set(double(buffers.used_bytes));
+    buffer_ranges_.set(double(buffers.ranges));
+
+    const auto memory = editor.getMemoryStats();
+    heights_bytes_.set(double(memory.heights));
+    layers_bytes_.set(double(memory.layers));
+    frame_arena_bytes_.set(double(memory.frame_arena));
+    mesh_texture_bytes_.set(double(memory.mesh_texture));
+    upload_ring_bytes_.set(double(memory.upload_ring));
+    const auto objects = GetGLObjectCounts();
+    gl_buffers_.set(double(objects.buffers));
+    gl_vertex_arrays_.set(double(objects.vertex_arrays));
+    gl_textures_.set(double(objects.textures));
+
+    const auto allocations = TotalAllocations();
+    allocations_.set(allocations.allocations);
+    allocated_bytes_.set(allocations.bytes);
+    heap_bytes_.set(double(HeapBytes()));
+}
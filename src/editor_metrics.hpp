@@ -0,0 +1,60 @@
+#pragma once
+
+#include "editor.hpp"
+#include "metrics.hpp"
+
+// Publishes the statistics the editor and its subsystems keep, and the frame time, to a metrics
+// registry once per frame. GPU buffer pool usage or GL object counts that keep growing over a
+// session point at leaked meshes.
+class EditorMetrics {
+  public:
+    explicit EditorMetrics(MetricsRegistry& registry);
+
+    void sample(const Editor& editor, float frame_seconds);
+
+  private:
+    // Renderer
+    Histogram& frame_seconds_;
+    Gauge& gpu_frame_seconds_;
+    Counter& draw_calls_;
+    Counter& triangles_;
+    Counter& gl_state_calls_;
+    Counter& gl_state_elided_;
+    // Editor
+    Counter& dabs_;
+    Gauge& history_strokes_;
+    Gauge& history_bytes_;
+    Gauge& layer_tiles_;
+    Counter& journal_checkpoints_;
+    Gauge& journal_bytes_;
+    // Loader
+    Gauge& resident_tiles_;
+    Gauge& resident_bytes_;
+    Gauge& compressed_bytes_;
+    Counter& cache_hits_;
+    Counter& cache_misses_;
+    Counter& tile_loads_;
+    Counter& tile_evictions_;
+    Counter& prefetch_issued_;
+    Counter& prefetch_stall_frames_;
+    // Uploader
+    Counter& uploaded_bytes_;
+    Counter& upload_overflows_;
+    Gauge& buffer_blocks_;
+    Gauge& buffer_capacity_bytes_;
+    Gauge& buffer_used_bytes_;
+    Gauge& buffer_ranges_;
+    // Memory
+    Gauge& heights_bytes_;
+    Gauge& layers_bytes_;
+    Gauge& frame_arena_bytes_;
+    Gauge& mesh_texture_bytes_;
+    Gauge& upload_ring_bytes_;
+    Gauge& gl_buffers_;
+    Gauge& gl_vertex_arrays_;
+    Gauge& gl_textures_;
+    // Process
+    Counter& allocations_;
+    Counter& allocated_bytes_;
+    Gauge& heap_bytes_;
+};
@@ -0,0 +1,84 @@
+#include "file_lock.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+FileLock::FileLock(FileLock&& other) noexcept { *this = std::move(other); }
+
+FileLock& FileLock::operator=(FileLock&& other) noexcept {
+    if (this != &other) {
+        unlock();
+#ifdef _WIN32
+        file_ = std::exchange(other.file_, nullptr);
+#else
+        fd_ = std::exchange(other.fd_, -1);
+#endif
+    }
+    return *this;
+}
+
+FileLock::~FileLock() { unlock(); }
+
+bool FileLock::tryLock(const std::filesystem::path& path) {
+    unlock();
+#ifdef _WIN32
+    file_ = CreateFileW(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        file_ = nullptr;
+        return false;
+    }
+    // Windows locks are mandatory, so lock a byte far past the end where no read or mapping of
+    // the file ever reaches.
+    OVERLAPPED overlapped{};
+    overlapped.OffsetHigh = 0x7fffffff;
+    if (!LockFileEx(
+            file_, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, 1, 0, &overlapped)) {
+        CloseHandle(file_);
+        file_ = nullptr;
+        return false;
+    }
+#else
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        return false;
+    if (flock(fd_, LOCK_EX | LOCK_NB) != 0) {
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+#endif
+    return true;
+}
+
+void FileLock::unlock() {
+#ifdef _WIN32
+    if (file_)
+        CloseHandle(std::exchange(file_, nullptr));
+#else
+    if (fd_ >= 0)
+        ::close(std::exchange(fd_, -1));
+#endif
+}
+
+bool FileLock::isLocked() const {
+#ifdef _WIN32
+    return file_ != nullptr;
+#else
+    return fd_ >= 0;
+#endif
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <filesystem>
+
+// An exclusive advisory lock on a file, held until the lock is destroyed or the process exits,
+// crashes included. The file is created if it does not exist and its contents are left alone.
+class FileLock {
+  public:
+    FileLock() = default;
+    FileLock(const FileLock&)            = delete;
+    FileLock& operator=(const FileLock&) = delete;
+    FileLock(FileLock&& other) noexcept;
+    FileLock& operator=(FileLock&& other) noexcept;
+    ~FileLock();
+
+    // Returns false without waiting if another process, or another lock in this one, holds it.
+    bool tryLock(const std::filesystem::path& path);
+    void unlock();
+
+    bool isLocked() const;
+
+  private:
+#ifdef _WIN32
+    void* file_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
@@ -0,0 +1,35 @@
+#include "frame_arena.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+
+FrameArena::FrameArena(size_t capacity)
+  : block_{std::make_unique_for_overwrite<std::byte[]>(capacity)}, capacity_{capacity} {}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment) {
+    const auto base    = reinterpret_cast<uintptr_t>(block_.get());
+    const auto aligned = (base + used_ + alignment - 1) & ~uintptr_t(alignment - 1);
+    if (aligned + bytes <= base + capacity_) {
+        used_ = aligned + bytes - base;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    // Operator new[] only guarantees fundamental alignment.
+    const auto size = bytes + alignment;
+    spills_.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+    spilled_ += size;
+    const auto spill = reinterpret_cast<uintptr_t>(spills_.back().get());
+    return reinterpret_cast<void*>((spill + alignment - 1) & ~uintptr_t(alignment - 1));
+}
+
+void FrameArena::reset() {
+    peak_ = std::max(peak_, getUsed());
+    if (!spills_.empty()) {
+        spills_.clear();
+        capacity_ = std::bit_ceil(peak_);
+        block_    = std::make_unique_for_overwrite<std::byte[]>(capacity_);
+    }
+    used_    = 0;
+    spilled_ = 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Linear allocator for data that lives until the end of the frame.
+//
+// Allocations bump a pointer through one block and reset() releases them all at once. A frame that
+// outgrows the block spills into extra blocks, which reset() folds into a single larger block, so
+// once the frames' peak usage has been seen the arena stops touching the heap.
+class FrameArena {
+  public:
+    static constexpr size_t DefaultCapacity = size_t{1} << 20;
+
+    explicit FrameArena(size_t capacity = DefaultCapacity);
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    // Default initialised, so trivial types hold garbage.
+    template <typename T>
+    std::span<T> allocate(size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>);
+        const auto pointer = static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        std::uninitialized_default_construct_n(pointer, count);
+        return {pointer, count};
+    }
+
+    void reset();
+
+    auto getCapacity() const { return capacity_; }
+    // Bytes handed out since the last reset, including alignment padding.
+    auto getUsed() const { return used_ + spilled_; }
+    // Most bytes used by any frame so far.
+    auto getPeak() const { return peak_; }
+
+  private:
+    std::unique_ptr<std::byte[]> block_;
+    size_t capacity_;
+    size_t used_ = 0;
+    std::vector<std::unique_ptr<std::byte[]>> spills_;
+    size_t spilled_ = 0;
+    size_t peak_    = 0;
+};
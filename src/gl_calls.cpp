@@ -0,0 +1,135 @@
+#include "gl_calls.hpp"
+
+#include <algorithm>
+#include <type_traits>
+
+#include <glad/glad.h>
+
+namespace {
+struct Entry {
+    const char* name;
+    uint64_t calls;
+    uint64_t frame_calls;
+    uint64_t max_frame_calls;
+};
+
+std::vector<Entry> entries;
+uint64_t frames = 0;
+
+template <auto& Pointer, typename Function = std::remove_reference_t<decltype(Pointer)>>
+struct Counted;
+
+template <auto& Pointer, typename Result, typename... Arguments>
+struct Counted<Pointer, Result(APIENTRYP)(Arguments...)> {
+    static inline Result(APIENTRYP original)(Arguments...) = nullptr;
+    static inline size_t index                             = 0;
+
+    static Result APIENTRY call(Arguments... arguments) {
+        entries[index].frame_calls++;
+        return original(arguments...);
+    }
+
+    static void install(const char* name) {
+        if (!Pointer || original)
+            return;
+        original = Pointer;
+        index    = std::size(entries);
+        entries.push_back({name, 0, 0, 0});
+        Pointer = call;
+    }
+};
+} // namespace
+
+#define COUNT_GL_CALLS(name) Counted<glad_##name>::install(#name)
+
+void InstallGLCallCounter() {
+    COUNT_GL_CALLS(glActiveTexture);
+    COUNT_GL_CALLS(glAttachShader);
+    COUNT_GL_CALLS(glBindBuffer);
+    COUNT_GL_CALLS(glBindTexture);
+    COUNT_GL_CALLS(glBindVertexArray);
+    COUNT_GL_CALLS(glBlendFunc);
+    COUNT_GL_CALLS(glBufferData);
+    COUNT_GL_CALLS(glBufferStorage);
+    COUNT_GL_CALLS(glBufferSubData);
+    COUNT_GL_CALLS(glClear);
+    COUNT_GL_CALLS(glClearColor);
+    COUNT_GL_CALLS(glClientWaitSync);
+    COUNT_GL_CALLS(glCompileShader);
+    COUNT_GL_CALLS(glCopyBufferSubData);
+    COUNT_GL_CALLS(glCreateProgram);
+    COUNT_GL_CALLS(glCreateShader);
+    COUNT_GL_CALLS(glDeleteBuffers);
+    COUNT_GL_CALLS(glDeleteProgram);
+    COUNT_GL_CALLS(glDeleteQueries);
+    COUNT_GL_CALLS(glDeleteShader);
+    COUNT_GL_CALLS(glDeleteSync);
+    COUNT_GL_CALLS(glDeleteTextures);
+    COUNT_GL_CALLS(glDeleteVertexArrays);
+    COUNT_GL_CALLS(glDepthFunc);
+    COUNT_GL_CALLS(glDisable);
+    COUNT_GL_CALLS(glDrawArrays);
+    COUNT_GL_CALLS(glDrawElements);
+    COUNT_GL_CALLS(glEnable);
+    COUNT_GL_CALLS(glEnableVertexAttribArray);
+    COUNT_GL_CALLS(glFenceSync);
+    COUNT_GL_CALLS(glGenBuffers);
+    COUNT_GL_CALLS(glGenQueries);
+    COUNT_GL_CALLS(glGenTextures);
+    COUNT_GL_CALLS(glGenVertexArrays);
+    COUNT_GL_CALLS(glGetInteger64v);
+    COUNT_GL_CALLS(glGetProgramInfoLog);
+    COUNT_GL_CALLS(glGetProgramiv);
+    COUNT_GL_CALLS(glGetQueryObjectiv);
+    COUNT_GL_CALLS(glGetQueryObjectui64v);
+    COUNT_GL_CALLS(glGetShaderInfoLog);
+    COUNT_GL_CALLS(glGetShaderiv);
+    COUNT_GL_CALLS(glGetUniformLocation);
+    COUNT_GL_CALLS(glLinkProgram);
+    COUNT_GL_CALLS(glMapBufferRange);
+    COUNT_GL_CALLS(glPixelStorei);
+    COUNT_GL_CALLS(glPolygonMode);
+    COUNT_GL_CALLS(glQueryCounter);
+    COUNT_GL_CALLS(glShaderSource);
+    COUNT_GL_CALLS(glTexImage2D);
+    COUNT_GL_CALLS(glTexParameteri);
+    COUNT_GL_CALLS(glTexSubImage2D);
+    COUNT_GL_CALLS(glUniform1f);
+    COUNT_GL_CALLS(glUniform1i);
+    COUNT_GL_CALLS(glUniform2f);
+    COUNT_GL_CALLS(glUniform2fv);
+    COUNT_GL_CALLS(glUniform3f);
+    COUNT_GL_CALLS(glUniform3fv);
+    COUNT_GL_CALLS(glUniform4f);
+    COUNT_GL_CALLS(glUniform4fv);
+    COUNT_GL_CALLS(glUniformMatrix2fv);
+    COUNT_GL_CALLS(glUniformMatrix3fv);
+    COUNT_GL_CALLS(glUniformMatrix4fv);
+    COUNT_GL_CALLS(glUnmapBuffer);
+    COUNT_GL_CALLS(glUseProgram);
+    COUNT_GL_CALLS(glVertexAttribPointer);
+    COUNT_GL_CALLS(glViewport);
+}
+
+void EndGLCallFrame() {
+    for (auto& entry : entries) {
+        entry.calls += entry.frame_calls;
+        entry.max_frame_calls = std::max(entry.max_frame_calls, entry.frame_calls);
+        entry.frame_calls     = 0;
+    }
+    frames++;
+}
+
+std::vector<GLCallStats> GetGLCallStats() {
+    std::vector<GLCallStats> stats;
+    for (auto& entry : entries) {
+        if (entry.calls > 0)
+            stats.push_back({entry.name, entry.calls, entry.max_frame_calls});
+    }
+    std::sort(stats.begin(), stats.end(), [](auto& a, auto& b) { return a.calls > b.calls; });
+    return stats;
+}
+
+uint64_t GetGLCallFrames() {
+    return frames;
+}
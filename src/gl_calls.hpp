@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Debug counters of the GL calls the program makes, by entry point. Installing them wraps glad's
+// function pointers of every entry point the program uses, after the state cache if any, so elided
+// calls count too. Built in with GL_CALL_COUNTER defined.
+void InstallGLCallCounter();
+// Closes the frame's counts.
+void EndGLCallFrame();
+
+struct GLCallStats {
+    const char* name;
+    uint64_t calls;
+    uint64_t max_frame_calls;
+};
+
+// Entry points that were called, most calls first.
+std::vector<GLCallStats> GetGLCallStats();
+uint64_t GetGLCallFrames();
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include <glad/glad.h>
+
+// Move-only owners of OpenGL object names; the object is deleted with its last owner. A default
+// constructed handle owns nothing, Create() makes a new object.
+//
+// Each type counts the objects currently owned, so a count that grows while the editor is in a
+// steady state shows a leak. Handles live on the GL thread, so the counts are plain integers.
+template <typename Traits>
+class GLObject {
+  public:
+    GLObject() = default;
+    explicit GLObject(GLuint id) : id_{id} { live_ += id != 0; }
+    GLObject(GLObject&& other) noexcept : id_{std::exchange(other.id_, 0)} {}
+    GLObject& operator=(GLObject&& other) noexcept {
+        if (this != &other) {
+            reset();
+            id_ = std::exchange(other.id_, 0);
+        }
+        return *this;
+    }
+    ~GLObject() { reset(); }
+
+    static GLObject Create() { return GLObject{Traits::Create()}; }
+    static size_t GetLive() { return live_; }
+
+    void reset(GLuint id = 0) {
+        if (id_) {
+            Traits::Destroy(id_);
+            live_--;
+        }
+        id_ = id;
+        live_ += id != 0;
+    }
+
+    GLuint get() const { return id_; }
+    explicit operator bool() const { return id_ != 0; }
+
+  private:
+    inline static size_t live_ = 0;
+    GLuint id_                 = 0;
+};
+
+struct BufferTraits {
+    static GLuint Create() {
+        GLuint id;
+        glGenBuffers(1, &id);
+        return id;
+    }
+    static void Destroy(GLuint id) { glDeleteBuffers(1, &id); }
+};
+
+struct VertexArrayTraits {
+    static GLuint Create() {
+        GLuint id;
+        glGenVertexArrays(1, &id);
+        return id;
+    }
+    static void Destroy(GLuint id) { glDeleteVertexArrays(1, &id); }
+};
+
+struct TextureTraits {
+    static GLuint Create() {
+        GLuint id;
+        glGenTextures(1, &id);
+        return id;
+    }
+    static void Destroy(GLuint id) { glDeleteTextures(1, &id); }
+};
+
+struct QueryTraits {
+    static GLuint Create() {
+        GLuint id;
+        glGenQueries(1, &id);
+        return id;
+    }
+    static void Destroy(GLuint id) { glDeleteQueries(1, &id); }
+};
+
+using Buffer      = GLObject<BufferTraits>;
+using VertexArray = GLObject<VertexArrayTraits>;
+using Texture     = GLObject<TextureTraits>;
+using Query       = GLObject<QueryTraits>;
+
+struct GLObjectCounts {
+    size_t buffers;
+    size_t vertex_arrays;
+    size_t textures;
+    size_t queries;
+};
+
+inline GLObjectCounts GetGLObjectCounts() {
+    return {Buffer::GetLive(), VertexArray::GetLive(), Texture::GetLive(), Query::GetLive()};
+}
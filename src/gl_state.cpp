@@ -0,0 +1,150 @@
+#include "gl_state.hpp"
+
+#include <array>
+#include <cstddef>
+
+#include <glad/glad.h>
+
+namespace {
+// Cached state that may differ from the context's; the next call passes.
+constexpr GLuint Unknown = ~GLuint{};
+
+// Buffer targets whose bindings are cached.
+constexpr std::array<GLenum, 6> Targets = {
+    GL_ARRAY_BUFFER,
+    GL_ELEMENT_ARRAY_BUFFER,
+    GL_COPY_READ_BUFFER,
+    GL_COPY_WRITE_BUFFER,
+    GL_PIXEL_PACK_BUFFER,
+    GL_PIXEL_UNPACK_BUFFER};
+constexpr size_t ElementArray = 1;
+
+struct State {
+    GLuint program      = Unknown;
+    GLuint vertex_array = Unknown;
+    std::array<GLuint, std::size(Targets)> buffers;
+    GLenum depth_func = Unknown;
+    GLStateStats stats{};
+};
+
+State state;
+
+PFNGLUSEPROGRAMPROC use_program;
+PFNGLDELETEPROGRAMPROC delete_program;
+PFNGLBINDVERTEXARRAYPROC bind_vertex_array;
+PFNGLDELETEVERTEXARRAYSPROC delete_vertex_arrays;
+PFNGLBINDBUFFERPROC bind_buffer;
+PFNGLBINDBUFFERBASEPROC bind_buffer_base;
+PFNGLBINDBUFFERRANGEPROC bind_buffer_range;
+PFNGLDELETEBUFFERSPROC delete_buffers;
+PFNGLDEPTHFUNCPROC depth_func;
+
+// Returns whether `value` changes `cached`, which then holds it.
+template <typename T>
+bool change(T& cached, T value) {
+    state.stats.calls++;
+    if (cached == value) {
+        state.stats.elided++;
+        return false;
+    }
+    cached = value;
+    return true;
+}
+
+GLuint* bufferSlot(GLenum target) {
+    for (auto i = size_t{}; i < std::size(Targets); i++) {
+        if (Targets[i] == target)
+            return &state.buffers[i];
+    }
+    return nullptr;
+}
+
+void APIENTRY useProgram(GLuint program) {
+    if (change(state.program, program))
+        use_program(program);
+}
+
+void APIENTRY deleteProgram(GLuint program) {
+    // A program in use is only flagged for deletion; stay out of its way.
+    if (program == state.program)
+        state.program = Unknown;
+    delete_program(program);
+}
+
+void APIENTRY bindVertexArray(GLuint vertex_array) {
+    if (!change(state.vertex_array, vertex_array))
+        return;
+    bind_vertex_array(vertex_array);
+    state.buffers[ElementArray] = Unknown;
+}
+
+void APIENTRY deleteVertexArrays(GLsizei count, const GLuint* vertex_arrays) {
+    for (auto i = 0; i < count; i++) {
+        if (vertex_arrays[i] == state.vertex_array) {
+            state.vertex_array          = 0;
+            state.buffers[ElementArray] = Unknown;
+        }
+    }
+    delete_vertex_arrays(count, vertex_arrays);
+}
+
+void APIENTRY bindBuffer(GLenum target, GLuint buffer) {
+    auto slot = bufferSlot(target);
+    if (!slot || change(*slot, buffer))
+        bind_buffer(target, buffer);
+}
+
+void APIENTRY bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    if (auto slot = bufferSlot(target))
+        *slot = Unknown;
+    bind_buffer_base(target, index, buffer);
+}
+
+void APIENTRY bindBufferRange(
+    GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    if (auto slot = bufferSlot(target))
+        *slot = Unknown;
+    bind_buffer_range(target, index, buffer, offset, size);
+}
+
+// Deleting a bound buffer unbinds it.
+void APIENTRY deleteBuffers(GLsizei count, const GLuint* buffers) {
+    for (auto i = 0; i < count; i++) {
+        for (auto& slot : state.buffers) {
+            if (slot == buffers[i])
+                slot = 0;
+        }
+    }
+    delete_buffers(count, buffers);
+}
+
+void APIENTRY depthFunc(GLenum func) {
+    if (change(state.depth_func, func))
+        depth_func(func);
+}
+
+template <typename Function>
+void hook(Function& pointer, Function& original, Function replacement) {
+    if (!pointer || original)
+        return;
+    original = pointer;
+    pointer  = replacement;
+}
+} // namespace
+
+void InstallGLStateCache() {
+    state.buffers.fill(Unknown);
+    hook(glad_glUseProgram, use_program, useProgram);
+    hook(glad_glDeleteProgram, delete_program, deleteProgram);
+    hook(glad_glBindVertexArray, bind_vertex_array, bindVertexArray);
+    hook(glad_glDeleteVertexArrays, delete_vertex_arrays, deleteVertexArrays);
+    hook(glad_glBindBuffer, bind_buffer, bindBuffer);
+    hook(glad_glBindBufferBase, bind_buffer_base, bindBufferBase);
+    hook(glad_glBindBufferRange, bind_buffer_range, bindBufferRange);
+    hook(glad_glDeleteBuffers, delete_buffers, deleteBuffers);
+    hook(glad_glDepthFunc, depth_func, depthFunc);
+}
+
+GLStateStats GetGLStateStats() {
+    return state.stats;
+}
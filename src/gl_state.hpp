@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+// Filters redundant state changes out of the GL calls the program makes: glUseProgram,
+// glBindVertexArray, glBindBuffer and glDepthFunc reach the driver only when they change the
+// current state. The filter replaces glad's function pointers, so every caller goes through it;
+// it must be installed right after loading them, while the context still has its default state,
+// and the context must be used from one thread.
+//
+// Calls that change the cached state behind the filter's back are tracked too: deleting a bound
+// object, binding an indexed buffer and switching vertex arrays, which carry their element array
+// buffer.
+void InstallGLStateCache();
+
+// Running totals of the filtered calls.
+struct GLStateStats {
+    uint64_t calls;
+    uint64_t elided;
+};
+
+GLStateStats GetGLStateStats();
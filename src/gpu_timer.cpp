@@ -0,0 +1,90 @@
+#include "gpu_timer.hpp"
+
+#include <algorithm>
+
+namespace {
+// Weight of the newest frame in the averages.
+constexpr double Smoothing = 1.0 / 60.0;
+} // namespace
+
+GpuTimer::GpuTimer() : supported_{glQueryCounter != nullptr && glGetQueryObjectui64v != nullptr} {
+    if (!supported_)
+        return;
+    for (auto& frame : queries_) {
+        for (auto& query : frame)
+            query = Query::Create();
+    }
+    clock_.calibrate();
+}
+
+void GpuTimer::beginFrame() {
+    if (!supported_)
+        return;
+    end();
+    frame_ = (frame_ + 1) % Latency;
+    collect(frame_);
+    clock_.tick();
+}
+
+void GpuTimer::begin(const char* name) {
+    auto& frame = frames_[frame_];
+    if (!supported_ || frame.count == MaxPasses)
+        return;
+    end();
+    frame.names[frame.count] = name;
+    glQueryCounter(queries_[frame_][2 * frame.count].get(), GL_TIMESTAMP);
+    frame.open = true;
+}
+
+void GpuTimer::end() {
+    auto& frame = frames_[frame_];
+    if (!frame.open)
+        return;
+    glQueryCounter(queries_[frame_][2 * frame.count + 1].get(), GL_TIMESTAMP);
+    frame.count++;
+    frame.open = false;
+}
+
+void GpuTimer::collect(size_t slot) {
+    auto& frame = frames_[slot];
+    if (frame.count == 0)
+        return;
+    const auto& queries = queries_[slot];
+    GLint available     = 0;
+    glGetQueryObjectiv(queries[2 * frame.count - 1].get(), GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        skipped_frames_++;
+        frame = {};
+        return;
+    }
+    for (auto i = size_t{}; i < frame.count; i++) {
+        GLuint64 start, end;
+        glGetQueryObjectui64v(queries[2 * i].get(), GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[2 * i + 1].get(), GL_QUERY_RESULT, &end);
+        const auto name = frame.names[i];
+        const auto ms   = double(end - start) / 1e6;
+        auto found      = std::find_if(
+            passes_.begin(), passes_.end(), [name](auto& pass) { return pass.name == name; });
+        if (found == passes_.end())
+            found = passes_.insert(found, {name, ms, ms, 0});
+        found->last_ms = ms;
+        found->average_ms += (ms - found->average_ms) * Smoothing;
+        found->frames++;
+#ifdef PROFILER
+        track_.record(name, clock_.toCpu(start), clock_.toCpu(end));
+#endif
+    }
+    frame = {};
+}
+
+void GpuClock::calibrate() {
+    GLint64 gpu;
+    glGetInteger64v(GL_TIMESTAMP, &gpu);
+    offset_ = int64_t(ProfileClock()) - gpu;
+    frames_ = 0;
+}
+
+void GpuClock::tick() {
+    if (++frames_ == CalibrationInterval)
+        calibrate();
+}
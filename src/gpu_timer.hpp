@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "gl_object.hpp"
+#include "profiler.hpp"
+
+// Maps GPU timestamps, in nanoseconds, to ProfileClock(). The clocks drift apart, so the owner
+// realigns them every CalibrationInterval frames.
+class GpuClock {
+  public:
+    static constexpr uint64_t CalibrationInterval = 600;
+
+    void calibrate();
+    // Calibrates once every CalibrationInterval calls; call once per frame.
+    void tick();
+
+    uint64_t toCpu(uint64_t gpu) const { return gpu + offset_; }
+
+  private:
+    // CPU minus GPU clock.
+    int64_t offset_  = 0;
+    uint64_t frames_ = 0;
+};
+
+// GPU time of the render passes of each frame, from timestamp queries.
+//
+// Results are read Latency frames later and only if they are available by then, so timing never
+// waits for the GPU; a frame whose queries are still pending is skipped. Passes show up on a
+// "GPU" track of the profiler trace, mapped to the CPU clock, and as per pass statistics.
+// Without timer queries, e.g. on drivers lacking GL 3.3, nothing is measured.
+class GpuTimer {
+  public:
+    static constexpr size_t Latency   = 4;
+    static constexpr size_t MaxPasses = 8;
+
+    struct Pass {
+        // A string literal; passes are told apart by its address.
+        const char* name;
+        double last_ms;
+        // Exponential average over roughly the last second at 60 frames per second.
+        double average_ms;
+        uint64_t frames;
+    };
+
+    GpuTimer();
+
+    // Collects the frame begun Latency frames ago and starts a new one.
+    void beginFrame();
+    // Passes do not nest; each begin() ends the pass before it.
+    void begin(const char* name);
+    void end();
+
+    bool isSupported() const { return supported_; }
+    const std::vector<Pass>& getPasses() const { return passes_; }
+    uint64_t getSkippedFrames() const { return skipped_frames_; }
+    // Realigned once per frame by beginFrame().
+    const GpuClock& getClock() const { return clock_; }
+
+  private:
+    struct Frame {
+        std::array<const char*, MaxPasses> names{};
+        size_t count = 0;
+        bool open    = false;
+    };
+
+    void collect(size_t slot);
+
+    bool supported_;
+    // Two timestamps per pass.
+    std::array<std::array<Query, 2 * MaxPasses>, Latency> queries_;
+    std::array<Frame, Latency> frames_{};
+    size_t frame_ = 0;
+    GpuClock clock_;
+    std::vector<Pass> passes_;
+    uint64_t skipped_frames_ = 0;
+#ifdef PROFILER
+    ProfileTrack track_{"GPU"};
+#endif
+};
@@ -1,49 +1,130 @@
 #include "grid.hpp"
 
-Grid::Grid(uint32_t width, uint32_t height)
-  : Grid(width, height, GenerateVertices(width, height), GenerateIndices(width, height)) {}
+#include <algorithm>
+#include <cstring>
+
+#include "profiler.hpp"
+
+Grid::Grid(BufferPool& pool, uint32_t width, uint32_t height)
+  : Grid(
+        pool,
+        width,
+        height,
+        std::vector<uint16_t>(size_t(width) * height),
+        {Quantization::Fit(0.0f, 0.0f)},
+        1,
+        GenerateIndices(width, height)) {}
 
 Grid::Grid(
+    BufferPool& pool,
     uint32_t width,
     uint32_t height,
-    std::vector<glm::vec3> vertices,
-    std::vector<uint32_t> indices)
-  : width_{width}, height_{height} {
-
-    glGenVertexArrays(1, &VAO_);
-
-    glGenBuffers(1, &VBO_);
+    const std::vector<uint16_t>& heights,
+    const std::vector<Quantization>& tiles,
+    uint32_t tiles_x,
+    const std::vector<uint32_t>& indices)
+  : vertex_array_{VertexArray::Create()},
+    vertices_{pool.allocate(std::size(heights) * sizeof(uint16_t))},
+    indices_{pool.allocate(std::size(indices) * sizeof(uint32_t))},
+    quantization_{Texture::Create()}, tiles_x_{tiles_x},
+    tiles_y_{uint32_t(std::size(tiles) / tiles_x)}, width_{width}, height_{height} {
+    vertices_.upload(std::data(heights), std::size(heights) * sizeof(uint16_t));
+    indices_.upload(std::data(indices), std::size(indices) * sizeof(uint32_t));
 
-    glGenBuffers(1, &EBO_);
-
-    glBindVertexArray(VAO_);
+    glBindVertexArray(vertex_array_.get());
+    glBindBuffer(GL_ARRAY_BUFFER, vertices_.getBuffer());
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices_.getBuffer());
+    // Normalised, so the shaders see code / 65535 and scale it by the full code range.
+    glVertexAttribPointer(
+        0, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(uint16_t), (void*)vertices_.getOffset());
+    glEnableVertexAttribArray(0);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO_);
-    glBufferData(
-        GL_ARRAY_BUFFER,
-        std::size(vertices) * sizeof(glm::vec3),
-        std::data(vertices),
-        GL_STATIC_DRAW);
+    std::vector<glm::vec2> texels;
+    for (auto& tile : tiles)
+        texels.emplace_back(tile.offset, tile.scale * Quantization::MaxCode);
+    glBindTexture(GL_TEXTURE_2D, quantization_.get());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(
+        GL_TEXTURE_2D,
+        0,
+        GL_RG32F,
+        tiles_x_,
+        tiles_y_,
+        0,
+        GL_RG,
+        GL_FLOAT,
+        std::data(texels));
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_);
-    glBufferData(
-        GL_ELEMENT_ARRAY_BUFFER,
-        std::size(indices) * sizeof(uint32_t),
-        std::data(indices),
-        GL_STATIC_DRAW);
+size_t Grid::update(
+    const std::vector<uint16_t>& heights,
+    uint32_t first_row,
+    uint32_t last_row,
+    const std::vector<Quantization>& tiles,
+    uint32_t tiles_x,
+    UploadRing& ring,
+    FrameArena& arena) {
+    PROFILE_ZONE("Grid::update");
+    const auto offset = size_t(first_row) * width_ * sizeof(uint16_t);
+    const auto bytes  = size_t(last_row - first_row) * width_ * sizeof(uint16_t);
+    const auto rows   = reinterpret_cast<const std::byte*>(std::data(heights)) + offset;
+    if (auto staging = bytes ? ring.allocate(bytes) : UploadRing::Allocation{}) {
+        std::memcpy(staging.data, rows, bytes);
+        ring.commit(staging);
+        glBindBuffer(GL_COPY_READ_BUFFER, ring.getBuffer());
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vertices_.getBuffer());
+        glCopyBufferSubData(
+            GL_COPY_READ_BUFFER,
+            GL_COPY_WRITE_BUFFER,
+            staging.offset,
+            vertices_.getOffset() + offset,
+            bytes);
+    } else if (bytes > 0) {
+        vertices_.upload(rows, bytes, offset);
+    }
 
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    const auto texel = [](const Quantization& tile) {
+        return glm::vec2{tile.offset, tile.scale * Quantization::MaxCode};
+    };
+    auto texels  = static_cast<const void*>(nullptr);
+    auto staging = ring.allocate(std::size(tiles) * sizeof(glm::vec2));
+    if (staging) {
+        std::transform(tiles.begin(), tiles.end(), static_cast<glm::vec2*>(staging.data), texel);
+        ring.commit(staging);
+        // With an unpack buffer bound the pointer is an offset into it.
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring.getBuffer());
+        texels = reinterpret_cast<const void*>(staging.offset);
+    } else {
+        auto staged = arena.allocate<glm::vec2>(std::size(tiles));
+        std::transform(tiles.begin(), tiles.end(), staged.begin(), texel);
+        texels = std::data(staged);
+    }
+    glBindTexture(GL_TEXTURE_2D, quantization_.get());
+    // Recentring the view can change how many tiles it spans.
+    if (const auto tiles_y = uint32_t(std::size(tiles) / tiles_x);
+        tiles_x != tiles_x_ || tiles_y != tiles_y_) {
+        tiles_x_ = tiles_x;
+        tiles_y_ = tiles_y;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, tiles_x_, tiles_y_, 0, GL_RG, GL_FLOAT, texels);
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tiles_x_, tiles_y_, GL_RG, GL_FLOAT, texels);
+    }
+    if (staging)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return bytes + std::size(tiles) * sizeof(glm::vec2);
 }
 
 void Grid::draw() {
     auto num_strips{height_ - 1};
     auto num_verts_per_strip{width_ * 2};
-    glBindVertexArray(VAO_);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, quantization_.get());
+    glBindVertexArray(vertex_array_.get());
     for (auto strip = 0; strip < num_strips; strip++)
         glDrawElements(
             GL_TRIANGLE_STRIP,
             num_verts_per_strip,
             GL_UNSIGNED_INT,
-            (void*)(sizeof(uint32_t) * num_verts_per_strip * strip));
+            (void*)(indices_.getOffset() + sizeof(uint32_t) * num_verts_per_strip * strip));
 }
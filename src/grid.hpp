@@ -6,26 +6,49 @@
 
 #include <glad/glad.h>
 
+#include "buffer_pool.hpp"
+#include "frame_arena.hpp"
+#include "gl_object.hpp"
+#include "quantization.hpp"
+#include "upload_ring.hpp"
+
+// Mesh of width x height vertices holding only 16-bit quantised heights; the vertex shaders place
+// vertex i at column i % width and row i / width. The quantisation of each tile the mesh spans is
+// bound to texture unit 0 as `tiles_x` wide RG32F texels of offset and full code range. Vertices
+// and indices live in ranges of `pool`.
 class Grid {
   public:
-    Grid(uint32_t width, uint32_t height);
+    Grid(BufferPool& pool, uint32_t width, uint32_t height);
 
     Grid(
+        BufferPool& pool,
         uint32_t width,
         uint32_t height,
-        std::vector<glm::vec3> vertices,
-        std::vector<uint32_t> indices);
+        const std::vector<uint16_t>& heights,
+        const std::vector<Quantization>& tiles,
+        uint32_t tiles_x,
+        const std::vector<uint32_t>& indices);
 
-    void draw();
+    // Uploads rows [first_row, last_row) of new heights and the tile quantisation into the
+    // existing buffers; the mesh keeps its size. Both go through `ring`, or directly and staged in
+    // `arena` while its frame's region is full. Returns the bytes uploaded.
+    size_t update(
+        const std::vector<uint16_t>& heights,
+        uint32_t first_row,
+        uint32_t last_row,
+        const std::vector<Quantization>& tiles,
+        uint32_t tiles_x,
+        UploadRing& ring,
+        FrameArena& arena);
 
+    void draw();
 
-    static auto GenerateVertices(uint32_t width, uint32_t height) {
-        std::vector<glm::vec3> vertices;
-        for (auto i = 0; i < height; i++)
-            for (auto j = 0; j < width; j++)
-                vertices.emplace_back(0.5f - (width / 2.f) + j, 0.0f, 0.5f - (height / 2.f) + i);
-        return vertices;
-    }
+    // What one draw() submits: a triangle strip per row of cells.
+    uint32_t getDrawCalls() const { return height_ - 1; }
+    uint64_t getTriangles() const { return uint64_t(height_ - 1) * (2 * width_ - 2); }
+    // GPU memory of the vertex and index ranges, and of the quantisation texture.
+    size_t getBufferBytes() const { return vertices_.getSize() + indices_.getSize(); }
+    size_t getTextureBytes() const { return size_t(tiles_x_) * tiles_y_ * sizeof(glm::vec2); }
 
     static auto GenerateIndices(uint32_t width, uint32_t height) {
         std::vector<uint32_t> indices;
@@ -39,9 +62,12 @@ class Grid {
     }
 
   private:
-    uint32_t VAO_;
-    uint32_t VBO_;
-    uint32_t EBO_;
+    VertexArray vertex_array_;
+    BufferPool::Range vertices_;
+    BufferPool::Range indices_;
+    Texture quantization_;
+    uint32_t tiles_x_;
+    uint32_t tiles_y_;
     uint32_t width_;
     uint32_t height_;
 };
\ No newline at end of file
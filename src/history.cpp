@@ -0,0 +1,204 @@
+#include "history.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace {
+void putVarint(std::vector<uint8_t>& out, size_t value) {
+    for (; value >= 0x80; value >>= 7)
+        out.push_back(uint8_t(value | 0x80));
+    out.push_back(uint8_t(value));
+}
+
+size_t getVarint(const uint8_t*& in) {
+    auto value = size_t{};
+    for (auto shift = 0;; shift += 7) {
+        const auto byte = *in++;
+        value |= size_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+}
+
+uint32_t bits(float value) {
+    uint32_t word;
+    std::memcpy(&word, &value, sizeof(word));
+    return word;
+}
+
+// Appends before ^ after as alternating (zero run, literal run) pairs of word counts, each
+// followed by the literal words.
+void encodeDelta(
+    const float* before, const float* after, size_t count, std::vector<uint8_t>& out) {
+    for (auto i = size_t{}; i < count;) {
+        const auto zeros = i;
+        while (i < count && bits(before[i]) == bits(after[i]))
+            i++;
+        const auto literals = i;
+        while (i < count && bits(before[i]) != bits(after[i]))
+            i++;
+        putVarint(out, literals - zeros);
+        putVarint(out, i - literals);
+        for (auto j = literals; j < i; j++) {
+            const auto word = bits(before[j]) ^ bits(after[j]);
+            out.insert(
+                out.end(),
+                {uint8_t(word), uint8_t(word >> 8), uint8_t(word >> 16), uint8_t(word >> 24)});
+        }
+    }
+}
+
+void applyDelta(const uint8_t* in, float* samples, size_t count) {
+    for (auto i = size_t{}; i < count;) {
+        i += getVarint(in);
+        for (auto literals = getVarint(in); literals > 0; literals--, i++, in += 4) {
+            const auto word = bits(samples[i])
+                              ^ (uint32_t(in[0]) | uint32_t(in[1]) << 8 | uint32_t(in[2]) << 16
+                                 | uint32_t(in[3]) << 24);
+            std::memcpy(&samples[i], &word, sizeof(word));
+        }
+    }
+}
+} // namespace
+
+History::History(
+    uint32_t tile_size,
+    Read read,
+    Write write,
+    std::filesystem::path spill_path,
+    size_t budget_bytes)
+  : tile_samples_{size_t(tile_size) * tile_size}, read_{std::move(read)}, write_{std::move(write)},
+    spill_path_{std::move(spill_path)}, budget_bytes_{budget_bytes} {}
+
+History::~History() {
+    if (spill_file_.is_open()) {
+        spill_file_.close();
+        std::error_code error;
+        std::filesystem::remove(spill_path_, error);
+    }
+}
+
+void History::begin() {
+    recording_ = true;
+    before_.clear();
+}
+
+void History::record(uint32_t tx, uint32_t ty, const float* samples) {
+    if (!recording_)
+        return;
+    if (auto [found, inserted] = before_.try_emplace(TileKey(tx, ty)); inserted)
+        found->second.assign(samples, samples + tile_samples_);
+}
+
+void History::commit() {
+    if (!recording_)
+        return;
+    recording_ = false;
+    if (before_.empty())
+        return;
+
+    Stroke stroke{};
+    for (auto& [key, before] : before_) {
+        const auto after = read_(uint32_t(key), uint32_t(key >> 32));
+        if (std::memcmp(std::data(before), after, tile_samples_ * sizeof(float)) == 0)
+            continue;
+        stroke.tiles.emplace_back(key, std::size(stroke.data));
+        encodeDelta(std::data(before), after, tile_samples_, stroke.data);
+    }
+    before_.clear();
+    if (stroke.tiles.empty())
+        return;
+
+    truncate();
+    stroke.data.shrink_to_fit();
+    stroke.bytes = std::size(stroke.data);
+    memory_bytes_ += stroke.bytes;
+    strokes_.push_back(std::move(stroke));
+    position_ = std::size(strokes_);
+    spill();
+}
+
+bool History::undo() {
+    if (recording_ || position_ == 0)
+        return false;
+    apply(strokes_[--position_]);
+    return true;
+}
+
+bool History::redo() {
+    if (recording_ || position_ == std::size(strokes_))
+        return false;
+    apply(strokes_[position_++]);
+    return true;
+}
+
+void History::apply(const Stroke& stroke) {
+    auto data = std::data(stroke.data);
+    std::vector<uint8_t> loaded;
+    if (stroke.data.empty()) {
+        loaded.resize(stroke.bytes);
+        spill_file_.seekg(std::streamoff(stroke.spill_offset));
+        if (!spill_file_.read(
+                reinterpret_cast<char*>(std::data(loaded)), std::streamsize(stroke.bytes))) {
+            std::cout << "ERROR::HISTORY::SPILL_READ_FAILED " << spill_path_.string() << std::endl;
+            spill_file_.clear();
+            return;
+        }
+        data = std::data(loaded);
+    }
+    for (auto& [key, offset] : stroke.tiles)
+        applyDelta(data + offset, write_(uint32_t(key), uint32_t(key >> 32)), tile_samples_);
+}
+
+// Drops the undone strokes that a new stroke makes unreachable.
+void History::truncate() {
+    for (auto i = position_; i < std::size(strokes_); i++)
+        memory_bytes_ -= std::size(strokes_[i].data);
+    if (position_ < spilled_) {
+        spill_end_ = strokes_[position_].spill_offset;
+        spilled_   = position_;
+    }
+    strokes_.resize(position_);
+}
+
+void History::spill() {
+    while (memory_bytes_ > budget_bytes_ && spilled_ < std::size(strokes_)) {
+        if (!spill_file_.is_open()) {
+            spill_file_.open(
+                spill_path_, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!spill_file_) {
+                std::cout << "ERROR::HISTORY::SPILL_OPEN_FAILED " << spill_path_.string()
+                          << std::endl;
+                // Keep the history in memory rather than losing it.
+                budget_bytes_ = SIZE_MAX;
+                return;
+            }
+        }
+        auto& stroke = strokes_[spilled_];
+        spill_file_.seekp(std::streamoff(spill_end_));
+        if (!spill_file_.write(
+                reinterpret_cast<const char*>(std::data(stroke.data)),
+                std::streamsize(stroke.bytes))) {
+            std::cout << "ERROR::HISTORY::SPILL_WRITE_FAILED " << spill_path_.string()
+                      << std::endl;
+            spill_file_.clear();
+            budget_bytes_ = SIZE_MAX;
+            return;
+        }
+        stroke.spill_offset = spill_end_;
+        spill_end_ += stroke.bytes;
+        memory_bytes_ -= stroke.bytes;
+        stroke.data = {};
+        spilled_++;
+    }
+}
+
+void History::setBudget(size_t budget_bytes) {
+    budget_bytes_ = budget_bytes;
+    spill();
+}
+
+History::Stats History::getStats() const {
+    return {std::size(strokes_), position_, memory_bytes_, spilled_, spill_end_};
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tile_cache.hpp"
+
+// Stroke-level undo/redo over square tiles reached through `read` and `write` accessors.
+//
+// record() keeps a before-image of each tile the first time a stroke touches it. commit() turns
+// those into the XOR of the before and after samples, run-length encoded over the unchanged
+// (zero) words, so one record both undoes and redoes a stroke and costs only the touched tiles.
+// Once the records in memory exceed the budget the oldest are spilled to `spill_path` and read
+// back when undo reaches them. The editor gives each history a file of its own in the temporary
+// directory, named after the map, the process and the editor.
+class History {
+  public:
+    struct Stats {
+        size_t strokes;
+        // Strokes currently applied; undo() steps back from here.
+        size_t position;
+        size_t memory_bytes;
+        size_t spilled_strokes;
+        size_t spilled_bytes;
+    };
+
+    using Read  = std::function<const float*(uint32_t tx, uint32_t ty)>;
+    using Write = std::function<float*(uint32_t tx, uint32_t ty)>;
+
+    static constexpr size_t DefaultBudget = size_t{64} << 20;
+
+    History(
+        uint32_t tile_size,
+        Read read,
+        Write write,
+        std::filesystem::path spill_path,
+        size_t budget_bytes = DefaultBudget);
+    History(const History&)            = delete;
+    History& operator=(const History&) = delete;
+    ~History();
+
+    void begin();
+    bool isRecording() const { return recording_; }
+    // Call before the first write to a tile in the current stroke; later calls are ignored.
+    void record(uint32_t tx, uint32_t ty, const float* samples);
+    void commit();
+
+    bool undo();
+    bool redo();
+
+    void setBudget(size_t budget_bytes);
+    Stats getStats() const;
+
+  private:
+    struct Stroke {
+        // Per touched tile: its key, and the offset of its delta in data.
+        std::vector<std::pair<uint64_t, size_t>> tiles;
+        // Emptied once spilled.
+        std::vector<uint8_t> data;
+        size_t bytes;
+        size_t spill_offset;
+    };
+
+    void apply(const Stroke& stroke);
+    void truncate();
+    void spill();
+
+    size_t tile_samples_;
+    Read read_;
+    Write write_;
+    std::filesystem::path spill_path_;
+    std::fstream spill_file_;
+    size_t budget_bytes_;
+
+    bool recording_ = false;
+    std::unordered_map<uint64_t, std::vector<float>> before_;
+
+    std::deque<Stroke> strokes_;
+    size_t position_     = 0;
+    size_t memory_bytes_ = 0;
+    // Strokes spill oldest first, so the spilled ones are the prefix [0, spilled_).
+    size_t spilled_   = 0;
+    size_t spill_end_ = 0;
+};
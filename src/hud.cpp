@@ -0,0 +1,327 @@
+#include "hud.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+
+#include "learnopengl/shader.hpp"
+
+namespace {
+constexpr uint32_t GlyphWidth  = 5;
+constexpr uint32_t GlyphHeight = 7;
+// Glyphs sit in cells one texel wider and taller, which leaves the spacing between them.
+constexpr uint32_t CellWidth  = GlyphWidth + 1;
+constexpr uint32_t CellHeight = GlyphHeight + 1;
+// ASCII 32 to 95; lower case letters are drawn as capitals.
+constexpr char FirstGlyph = ' ';
+constexpr size_t Glyphs   = 64;
+// A fully covered cell after the glyphs, for solid quads.
+constexpr size_t Solid = Glyphs;
+// Two triangles per quad.
+constexpr float Corners[6][2] = {{0, 0}, {1, 0}, {0, 1}, {1, 0}, {1, 1}, {0, 1}};
+
+// Rows from the top, the leftmost pixel in bit 4.
+constexpr uint8_t Font[Glyphs][GlyphHeight] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // space
+    {0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04}, // !
+    {0x0a, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x00}, // "
+    {0x0a, 0x0a, 0x1f, 0x0a, 0x1f, 0x0a, 0x0a}, // #
+    {0x04, 0x0f, 0x14, 0x0e, 0x05, 0x1e, 0x04}, // $
+    {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}, // %
+    {0x0c, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0d}, // &
+    {0x0c, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00}, // '
+    {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}, // (
+    {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}, // )
+    {0x00, 0x04, 0x15, 0x0e, 0x15, 0x04, 0x00}, // *
+    {0x00, 0x04, 0x04, 0x1f, 0x04, 0x04, 0x00}, // +
+    {0x00, 0x00, 0x00, 0x00, 0x0c, 0x04, 0x08}, // ,
+    {0x00, 0x00, 0x00, 0x1f, 0x00, 0x00, 0x00}, // -
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c}, // .
+    {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}, // /
+    {0x0e, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0e}, // 0
+    {0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e}, // 1
+    {0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f}, // 2
+    {0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e}, // 3
+    {0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02}, // 4
+    {0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e}, // 5
+    {0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e}, // 6
+    {0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+    {0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e}, // 8
+    {0x0e, 0x11, 0x11, 0x0f, 0x01, 0x02, 0x0c}, // 9
+    {0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x0c, 0x00}, // :
+    {0x00, 0x0c, 0x0c, 0x00, 0x0c, 0x04, 0x08}, // ;
+    {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}, // <
+    {0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00}, // =
+    {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}, // >
+    {0x0e, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}, // ?
+    {0x0e, 0x11, 0x17, 0x15, 0x17, 0x10, 0x0e}, // @
+    {0x0e, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}, // A
+    {0x1e, 0x11, 0x11, 0x1e, 0x11, 0x11, 0x1e}, // B
+    {0x0e, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0e}, // C
+    {0x1c, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1c}, // D
+    {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x1f}, // E
+    {0x1f, 0x10, 0x10, 0x1e, 0x10, 0x10, 0x10}, // F
+    {0x0e, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0f}, // G
+    {0x11, 0x11, 0x11, 0x1f, 0x11, 0x11, 0x11}, // H
+    {0x0e, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0e}, // I
+    {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0c}, // J
+    {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // K
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1f}, // L
+    {0x11, 0x1b, 0x15, 0x15, 0x11, 0x11, 0x11}, // M
+    {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // N
+    {0x0e, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e}, // O
+    {0x1e, 0x11, 0x11, 0x1e, 0x10, 0x10, 0x10}, // P
+    {0x0e, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0d}, // Q
+    {0x1e, 0x11, 0x11, 0x1e, 0x14, 0x12, 0x11}, // R
+    {0x0f, 0x10, 0x10, 0x0e, 0x01, 0x01, 0x1e}, // S
+    {0x1f, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // T
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0e}, // U
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x0a, 0x04}, // V
+    {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0a}, // W
+    {0x11, 0x11, 0x0a, 0x04, 0x0a, 0x11, 0x11}, // X
+    {0x11, 0x11, 0x0a, 0x04, 0x04, 0x04, 0x04}, // Y
+    {0x1f, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1f}, // Z
+    {0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0e}, // [
+    {0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00}, // backslash
+    {0x0e, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0e}, // ]
+    {0x04, 0x0a, 0x11, 0x00, 0x00, 0x00, 0x00}, // ^
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1f}, // _
+};
+
+// Screen pixels per font texel.
+constexpr float Scale      = 2.0f;
+constexpr float LineHeight = (CellHeight + 1) * Scale;
+constexpr float Margin     = 8.0f;
+constexpr float Padding    = 6.0f;
+constexpr size_t Columns   = 40;
+constexpr float BarWidth   = 2.0f;
+constexpr float Width      = std::max(Columns * CellWidth * Scale, Hud::History * BarWidth);
+constexpr size_t Lines     = 7;
+constexpr float GraphTop   = Margin + Padding + Lines * LineHeight;
+constexpr float GraphSize  = 64.0f;
+// Frame times the graph spans, and those of 60 and 30 frames per second.
+constexpr float GraphMs  = 50.0f;
+constexpr float TargetMs = 1000.0f / 60.0f;
+constexpr float SlowMs   = 1000.0f / 30.0f;
+// Vertices for the panel, Lines full lines of text and the graph with its target line.
+constexpr size_t MaxQuads = 2 + Lines * Columns + Hud::History;
+
+constexpr uint32_t rgba(uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+    return r | g << 8 | b << 16 | a << 24;
+}
+
+constexpr auto White      = rgba(255, 255, 255, 255);
+constexpr auto Grey       = rgba(255, 255, 255, 96);
+constexpr auto Background = rgba(0, 0, 0, 160);
+constexpr auto Green      = rgba(64, 208, 64, 255);
+constexpr auto Yellow     = rgba(232, 208, 48, 255);
+constexpr auto Red        = rgba(232, 64, 48, 255);
+} // namespace
+
+Hud::Hud()
+  : vertex_array_{VertexArray::Create()}, buffer_{Buffer::Create()}, font_{Texture::Create()} {
+    vertices_.reserve(6 * MaxQuads);
+    scratch_.reserve(LowWindow);
+
+    glBindVertexArray(vertex_array_.get());
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_.get());
+    glBufferData(GL_ARRAY_BUFFER, 6 * MaxQuads * sizeof(Vertex), nullptr, GL_STREAM_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x));
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, u));
+    glVertexAttribPointer(
+        2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+    for (auto attribute = 0; attribute < 3; attribute++)
+        glEnableVertexAttribArray(attribute);
+
+    // One row of cells, coverage in the red channel.
+    const auto atlas_width = (Glyphs + 1) * CellWidth;
+    std::vector<uint8_t> texels(atlas_width * CellHeight);
+    for (auto glyph = size_t{}; glyph <= Glyphs; glyph++) {
+        for (auto y = 0u; y < GlyphHeight; y++) {
+            for (auto x = 0u; x < GlyphWidth; x++) {
+                const auto set = glyph == Solid || Font[glyph][y] >> (GlyphWidth - 1 - x) & 1;
+                texels[y * atlas_width + glyph * CellWidth + x] = set ? 255 : 0;
+            }
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, font_.get());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(
+        GL_TEXTURE_2D,
+        0,
+        GL_R8,
+        atlas_width,
+        CellHeight,
+        0,
+        GL_RED,
+        GL_UNSIGNED_BYTE,
+        std::data(texels));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+void Hud::addFrame(float seconds, const Editor& editor) {
+    const auto& totals = editor.getRenderStats();
+
+    last_frame_.draw_calls     = totals.draw_calls - totals_.draw_calls;
+    last_frame_.triangles      = totals.triangles - totals_.triangles;
+    last_frame_.uploaded_bytes = totals.uploaded_bytes - totals_.uploaded_bytes;
+    last_frame_.dabs           = totals.dabs - totals_.dabs;
+    totals_                    = totals;
+
+    const auto gl_state = GetGLStateStats();
+    last_gl_state_      = {gl_state.calls - gl_state_.calls, gl_state.elided - gl_state_.elided};
+    gl_state_           = gl_state;
+
+    frames_[frame_count_ % History] = {seconds, last_frame_.dabs};
+    lows_[frame_count_ % LowWindow] = seconds * 1000.0f;
+    frame_count_++;
+}
+
+void Hud::draw(Shader& shader, int width, int height, const Editor& editor) {
+    if (frame_count_ == 0 || width <= 0 || height <= 0)
+        return;
+    vertices_.clear();
+    quad(
+        Margin,
+        Margin,
+        Width + 2 * Padding,
+        GraphTop + GraphSize + Padding - Margin,
+        Background);
+
+    // Dabs over roughly the last second.
+    const auto recorded = std::min(frame_count_, History);
+    auto seconds        = 0.0f;
+    auto dabs           = uint64_t{};
+    for (auto i = size_t{1}; i <= recorded && seconds < 1.0f; i++) {
+        const auto& frame = frames_[(frame_count_ - i) % History];
+        seconds += frame.seconds;
+        dabs += frame.dabs;
+    }
+
+    const auto last_ms = frames_[(frame_count_ - 1) % History].seconds * 1000.0f;
+    const auto left    = Margin + Padding;
+    const auto right   = left + Width;
+    auto y             = Margin + Padding;
+    char line[Columns + 1];
+    std::snprintf(
+        line,
+        sizeof(line),
+        "FRAME %.1f MS, %.0f FPS",
+        last_ms,
+        last_ms > 0.0f ? 1000.0f / last_ms : 0.0f);
+    text(left, y, line, White);
+    y += LineHeight;
+    std::snprintf(
+        line, sizeof(line), "1%% LOW %.1f MS, 0.1%% LOW %.1f MS", low(0.01f), low(0.001f));
+    text(left, y, line, White);
+    y += LineHeight;
+    std::snprintf(
+        line,
+        sizeof(line),
+        "DRAWS %llu, TRIANGLES %llu",
+        (unsigned long long)last_frame_.draw_calls,
+        (unsigned long long)last_frame_.triangles);
+    text(left, y, line, White);
+    y += LineHeight;
+    std::snprintf(
+        line,
+        sizeof(line),
+        "UPLOADED %.1f KIB, TILES %zu",
+        last_frame_.uploaded_bytes / 1024.0,
+        editor.getCacheStats().resident_tiles);
+    text(left, y, line, White);
+    y += LineHeight;
+    std::snprintf(line, sizeof(line), "DABS %.0f/S", seconds > 0.0f ? dabs / seconds : 0.0f);
+    text(left, y, line, White);
+    y += LineHeight;
+    std::snprintf(
+        line,
+        sizeof(line),
+        "GL STATE %llu OF %llu ELIDED",
+        (unsigned long long)last_gl_state_.elided,
+        (unsigned long long)last_gl_state_.calls);
+    text(left, y, line, White);
+    y += LineHeight;
+
+    // As many GPU passes as fit on the line.
+    auto x = text(left, y, "GPU MS", White);
+    for (auto& pass : editor.getGpuTimer().getPasses()) {
+        const auto length = std::snprintf(line, sizeof(line), " %s %.2f", pass.name, pass.last_ms);
+        if (x + length * CellWidth * Scale > right)
+            break;
+        x = text(x, y, line, White);
+    }
+
+    // Newest frame on the right.
+    const auto bottom = GraphTop + GraphSize;
+    for (auto i = size_t{1}; i <= recorded; i++) {
+        const auto ms    = frames_[(frame_count_ - i) % History].seconds * 1000.0f;
+        const auto bar   = std::min(ms, GraphMs) / GraphMs * GraphSize;
+        const auto color = ms <= TargetMs ? Green : ms <= SlowMs ? Yellow : Red;
+        quad(right - i * BarWidth, bottom - bar, BarWidth, bar, color);
+    }
+    quad(left, bottom - TargetMs / GraphMs * GraphSize, Width, 1.0f, Grey);
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_.get());
+    // Orphans last frame's storage, so the upload does not wait for the draw reading it.
+    glBufferData(GL_ARRAY_BUFFER, 6 * MaxQuads * sizeof(Vertex), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(
+        GL_ARRAY_BUFFER, 0, std::size(vertices_) * sizeof(Vertex), std::data(vertices_));
+
+    glDisable(GL_DEPTH_TEST);
+    shader.use();
+    shader.set("screen_size", glm::vec2(width, height));
+    shader.set("font", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, font_.get());
+    glBindVertexArray(vertex_array_.get());
+    glDrawArrays(GL_TRIANGLES, 0, GLsizei(std::size(vertices_)));
+    glEnable(GL_DEPTH_TEST);
+}
+
+void Hud::quad(float x, float y, float width, float height, uint32_t color) {
+    if (std::size(vertices_) + 6 > vertices_.capacity())
+        return;
+    // Every corner samples the middle of the solid cell.
+    const auto u = (Solid + 0.5f) * CellWidth;
+    const auto v = 0.5f * CellHeight;
+    for (auto [dx, dy] : Corners)
+        vertices_.push_back({x + dx * width, y + dy * height, u, v, color});
+}
+
+float Hud::text(float x, float y, const char* string, uint32_t color) {
+    for (; *string; string++, x += CellWidth * Scale) {
+        if (std::size(vertices_) + 6 > vertices_.capacity())
+            break;
+        auto c = *string;
+        if (c >= 'a' && c <= 'z')
+            c -= 'a' - 'A';
+        if (c < FirstGlyph || size_t(c - FirstGlyph) >= Glyphs)
+            c = '?';
+        const auto u = float((c - FirstGlyph) * CellWidth);
+        for (auto [dx, dy] : Corners) {
+            vertices_.push_back(
+                {x + dx * CellWidth * Scale,
+                 y + dy * CellHeight * Scale,
+                 u + dx * CellWidth,
+                 float(dy * CellHeight),
+                 color});
+        }
+    }
+    return x;
+}
+
+float Hud::low(float fraction) {
+    const auto count = std::min(frame_count_, LowWindow);
+    const auto worst = std::max(size_t{1}, size_t(count * fraction));
+    scratch_.assign(lows_.begin(), lows_.begin() + count);
+    std::nth_element(
+        scratch_.begin(), scratch_.begin() + (worst - 1), scratch_.end(), std::greater<>{});
+    auto sum = 0.0f;
+    for (auto i = size_t{}; i < worst; i++)
+        sum += scratch_[i];
+    return sum / worst;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "editor.hpp"
+#include "gl_object.hpp"
+#include "gl_state.hpp"
+
+class Shader;
+
+// Performance overlay in the top-left corner: frame time and rate, the average of the slowest 1%
+// and 0.1% of recent frames, a graph of the last History frame times, what the last frame drew
+// and uploaded, resident tiles, brush dabs per second, redundant GL state changes the state cache
+// dropped and the GPU time of each render pass.
+//
+// Text uses an embedded 5x7 pixel font. The whole overlay is built on the CPU into one vertex
+// buffer and drawn with a single call; building it reuses buffers reserved up front, so a visible
+// HUD does not allocate.
+class Hud {
+  public:
+    static constexpr size_t History = 240;
+    // Frames the lows are taken over.
+    static constexpr size_t LowWindow = 1000;
+
+    Hud();
+
+    void toggle() { visible_ = !visible_; }
+    bool isVisible() const { return visible_; }
+
+    // Records a frame, hidden or not, from the editor's running totals.
+    void addFrame(float seconds, const Editor& editor);
+
+    void draw(Shader& shader, int width, int height, const Editor& editor);
+
+  private:
+    struct Vertex {
+        float x, y;
+        // In font atlas texels.
+        float u, v;
+        // RGBA, a byte each.
+        uint32_t color;
+    };
+
+    struct Frame {
+        float seconds;
+        uint64_t dabs;
+    };
+
+    void quad(float x, float y, float width, float height, uint32_t color);
+    // Returns the x after the text.
+    float text(float x, float y, const char* string, uint32_t color);
+    // Average of the slowest `fraction` of the recorded frames, in milliseconds.
+    float low(float fraction);
+
+    bool visible_ = false;
+    VertexArray vertex_array_;
+    Buffer buffer_;
+    Texture font_;
+    std::vector<Vertex> vertices_;
+
+    std::array<Frame, History> frames_{};
+    std::array<float, LowWindow> lows_{};
+    std::vector<float> scratch_;
+    size_t frame_count_ = 0;
+    Editor::RenderStats totals_;
+    GLStateStats gl_state_{};
+    // What the last frame added to the totals.
+    Editor::RenderStats last_frame_;
+    GLStateStats last_gl_state_{};
+};
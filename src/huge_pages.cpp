@@ -0,0 +1,110 @@
+#include "huge_pages.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#if defined(__linux__) || defined(_WIN32)
+namespace {
+// Huge page aligned buffers all start at the same cache sets, so a kernel streaming through two
+// of them evicts its own lines; successive blocks start at rotating offsets instead. The cache line
+// before a block holds the address of its mapping.
+constexpr size_t ColourStep = 4096 + CacheLine;
+constexpr size_t Colours    = 16;
+
+std::atomic<size_t> next_colour;
+
+size_t roundUp(size_t bytes, size_t alignment) {
+    return (bytes + alignment - 1) / alignment * alignment;
+}
+
+void* place(void* base, size_t offset) {
+    const auto pointer                    = static_cast<std::byte*>(base) + offset;
+    reinterpret_cast<void**>(pointer)[-1] = base;
+    return pointer;
+}
+
+#ifdef __linux__
+void* mapHugePages(size_t size) {
+    constexpr auto Protection = PROT_READ | PROT_WRITE;
+    constexpr auto Flags      = MAP_PRIVATE | MAP_ANONYMOUS;
+    if (auto pointer = mmap(nullptr, size, Protection, Flags | MAP_HUGETLB, -1, 0);
+        pointer != MAP_FAILED)
+        return pointer;
+
+    // Transparent huge pages only back huge page aligned ranges, so map one more huge page and
+    // trim the ends.
+    const auto mapped = mmap(nullptr, size + HugePageSize, Protection, Flags, -1, 0);
+    if (mapped == MAP_FAILED)
+        return nullptr;
+    const auto raw     = static_cast<std::byte*>(mapped);
+    const auto aligned = raw + (HugePageSize - uintptr_t(raw) % HugePageSize) % HugePageSize;
+    if (aligned > raw)
+        munmap(raw, aligned - raw);
+    munmap(aligned + size, raw + HugePageSize - aligned);
+    madvise(aligned, size, MADV_HUGEPAGE);
+    return aligned;
+}
+#endif
+} // namespace
+#endif
+
+void* AllocateHugePages(size_t bytes, bool prefault) {
+#if defined(__linux__) || defined(_WIN32)
+    if (bytes < HugePageSize)
+        return ::operator new(bytes, std::align_val_t{CacheLine}, std::nothrow);
+    const auto offset = CacheLine + next_colour++ % Colours * ColourStep;
+    const auto size   = roundUp(bytes + offset, HugePageSize);
+#ifdef __linux__
+    auto pointer = mapHugePages(size);
+#ifdef MADV_POPULATE_WRITE
+    // One system call instead of a fault per page later; it fails harmlessly on kernels before
+    // 5.14, which leave the pages to fault in on first use.
+    if (pointer && prefault)
+        madvise(pointer, size, MADV_POPULATE_WRITE);
+#endif
+    return pointer ? place(pointer, offset) : nullptr;
+#elif defined(_WIN32)
+    // Large pages need the lock pages privilege and are committed, hence prefaulted, up front.
+    (void)prefault;
+    auto pointer = static_cast<void*>(nullptr);
+    if (const auto large = GetLargePageMinimum(); large > 0) {
+        pointer = VirtualAlloc(
+            nullptr,
+            roundUp(size, large),
+            MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+            PAGE_READWRITE);
+    }
+    if (!pointer)
+        pointer = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    return pointer ? place(pointer, offset) : nullptr;
+#endif
+#else
+    (void)prefault;
+    return ::operator new(bytes, std::align_val_t{CacheLine}, std::nothrow);
+#endif
+}
+
+void FreeHugePages(void* pointer, size_t bytes) {
+    if (!pointer)
+        return;
+#if defined(__linux__) || defined(_WIN32)
+    if (bytes >= HugePageSize) {
+        const auto base = static_cast<void**>(pointer)[-1];
+#ifdef __linux__
+        const auto offset = static_cast<std::byte*>(pointer) - static_cast<std::byte*>(base);
+        munmap(base, roundUp(bytes + size_t(offset), HugePageSize));
+#else
+        VirtualFree(base, 0, MEM_RELEASE);
+#endif
+        return;
+    }
+#endif
+    ::operator delete(pointer, std::align_val_t{CacheLine});
+}
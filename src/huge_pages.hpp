@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// Memory for large terrain buffers.
+//
+// Every block is CacheLine aligned. Blocks of at least HugePageSize are backed by huge pages
+// where the OS provides them: explicit ones (MAP_HUGETLB, or large pages on Windows) when some are
+// reserved, otherwise transparent huge pages on Linux. With `prefault` the pages are populated
+// before the allocation returns, so the first pass over a new buffer does not fault on every page.
+constexpr size_t CacheLine    = 64;
+constexpr size_t HugePageSize = size_t{2} << 20;
+
+void* AllocateHugePages(size_t bytes, bool prefault = false);
+void FreeHugePages(void* pointer, size_t bytes);
+
+template <typename T, bool Prefault = false>
+class HugePageAllocator {
+  public:
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = HugePageAllocator<U, Prefault>;
+    };
+
+    HugePageAllocator() = default;
+    template <typename U>
+    HugePageAllocator(const HugePageAllocator<U, Prefault>&) {}
+
+    T* allocate(size_t count) {
+        if (auto pointer = AllocateHugePages(count * sizeof(T), Prefault))
+            return static_cast<T*>(pointer);
+        throw std::bad_alloc{};
+    }
+
+    void deallocate(T* pointer, size_t count) { FreeHugePages(pointer, count * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const HugePageAllocator<U, Prefault>&) const {
+        return true;
+    }
+};
+
+template <typename T, bool Prefault = false>
+using HugePageVector = std::vector<T, HugePageAllocator<T, Prefault>>;
@@ -0,0 +1,70 @@
+#include "input_latency.hpp"
+
+#include <algorithm>
+
+InputLatency::InputLatency(MetricsRegistry& registry, const GpuTimer& gpu_timer)
+  : supported_{gpu_timer.isSupported()},
+    clock_{gpu_timer.getClock()},
+    total_{registry.histogram("input_latency_seconds", "Brush input to presentation")},
+    edit_{registry.histogram("input_edit_seconds", "Brush input to the end of its edit")},
+    queue_{registry.histogram("input_queue_seconds", "End of an edit to the frame showing it")},
+    present_{registry.histogram(
+        "input_present_seconds", "Submission of a frame showing an edit to its presentation")} {
+    if (!supported_)
+        return;
+    for (auto& query : queries_)
+        query = Query::Create();
+}
+
+void InputLatency::event() {
+    current_event_ = ProfileClock();
+}
+
+void InputLatency::edited() {
+    // The oldest edit a frame shows waited the longest.
+    if (pending_.event == 0 && current_event_ != 0)
+        pending_ = {current_event_, ProfileClock()};
+}
+
+void InputLatency::submitted() {
+    if (pending_.event != 0)
+        pending_.submitted = ProfileClock();
+}
+
+void InputLatency::swapped() {
+    if (!supported_ || pending_.event == 0)
+        return;
+    pending_.swapped = ProfileClock();
+    if (count_ == MaxFrames) {
+        dropped_frames_++;
+    } else {
+        const auto slot = (first_ + count_++) % MaxFrames;
+        frames_[slot]   = pending_;
+        glQueryCounter(queries_[slot].get(), GL_TIMESTAMP);
+    }
+    pending_ = {};
+}
+
+void InputLatency::collect() {
+    if (!supported_)
+        return;
+    for (; count_ > 0; first_ = (first_ + 1) % MaxFrames, count_--) {
+        const auto query = queries_[first_].get();
+        GLint available  = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return;
+        const auto& frame = frames_[first_];
+        GLuint64 gpu;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpu);
+        // The swap returns once the frame is queued, which may be after the GPU finished it.
+        const auto presented = std::max<uint64_t>(clock_.toCpu(gpu), frame.swapped);
+        edit_.record(frame.edited - frame.event);
+        queue_.record(frame.submitted - frame.edited);
+        present_.record(presented - frame.submitted);
+        total_.record(presented - frame.event);
+#ifdef PROFILER
+        track_.record("Brush latency", frame.event, presented);
+#endif
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "gl_object.hpp"
+#include "gpu_timer.hpp"
+#include "metrics.hpp"
+#include "profiler.hpp"
+
+// Input-to-photon latency of brush edits.
+//
+// Each frame that shows an edit follows its oldest edit from the input event that caused it,
+// through the edit and upload and the wait for the frame to be drawn, to when the GPU finished
+// that frame after the buffer swap; a timestamp query issued right after the swap gives the time,
+// read back without waiting some frames later and mapped to the CPU clock with the GPU timer's
+// clock. Scan-out adds up to one refresh on top. Events are
+// timed when GLFW dispatches them, so time spent queued in the OS is not included.
+//
+// The stages and the total go to latency histograms of the metrics registry and, with PROFILER,
+// to an "Input" track of the trace.
+class InputLatency {
+  public:
+    // Frames followed at once; edits of frames beyond that are dropped.
+    static constexpr size_t MaxFrames = 8;
+
+    InputLatency(MetricsRegistry& registry, const GpuTimer& gpu_timer);
+
+    // An input event is about to be handled.
+    void event();
+    // The event being handled edited the map.
+    void edited();
+    // The frame is drawn and about to be swapped.
+    void submitted();
+    // Follows the swapped frame if it shows edits.
+    void swapped();
+    // Records the frames the GPU has finished; call once per frame.
+    void collect();
+
+    // Event to presentation.
+    const Histogram& getTotal() const { return total_; }
+    // Event to the end of the edit, including its upload.
+    const Histogram& getEdit() const { return edit_; }
+    // End of the edit until the frame showing it was submitted.
+    const Histogram& getQueue() const { return queue_; }
+    // Submission until the GPU finished the frame after the swap.
+    const Histogram& getPresent() const { return present_; }
+    uint64_t getDroppedFrames() const { return dropped_frames_; }
+
+  private:
+    struct Frame {
+        uint64_t event     = 0;
+        uint64_t edited    = 0;
+        uint64_t submitted = 0;
+        uint64_t swapped   = 0;
+    };
+
+    bool supported_;
+    const GpuClock& clock_;
+    Histogram& total_;
+    Histogram& edit_;
+    Histogram& queue_;
+    Histogram& present_;
+    uint64_t current_event_ = 0;
+    // Edits waiting for a frame; event is 0 without any.
+    Frame pending_;
+    std::array<Frame, MaxFrames> frames_;
+    std::array<Query, MaxFrames> queries_;
+    size_t first_ = 0;
+    size_t count_ = 0;
+    uint64_t dropped_frames_ = 0;
+#ifdef PROFILER
+    ProfileTrack track_{"Input"};
+#endif
+};
@@ -0,0 +1,207 @@
+#include "input_log.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <thread>
+
+namespace {
+constexpr char Magic[4]      = {'T', 'V', 'I', 'L'};
+constexpr uint32_t Version   = 1;
+constexpr size_t HeaderBytes = sizeof(Magic) + sizeof(uint32_t);
+// Type byte and microseconds since the previous record.
+constexpr size_t RecordBytes = 1 + sizeof(uint32_t);
+
+size_t payloadBytes(InputEvent::Type type) {
+    switch (type) {
+    case InputEvent::Type::Frame:
+        return sizeof(float);
+    case InputEvent::Type::Cursor:
+    case InputEvent::Type::Scroll:
+        return 2 * sizeof(float);
+    case InputEvent::Type::Button:
+        return 3;
+    case InputEvent::Type::Key:
+        return sizeof(int16_t) + 2;
+    case InputEvent::Type::End:
+        return sizeof(uint64_t);
+    }
+    return 0;
+}
+
+template <typename T>
+T get(const uint8_t*& in) {
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+}
+} // namespace
+
+InputRecorder::InputRecorder(std::filesystem::path path)
+  : path_{std::move(path)}, file_{std::fopen(path_.string().c_str(), "wb")},
+    last_{std::chrono::steady_clock::now()} {
+    if (!file_) {
+        std::cout << "ERROR::INPUT_LOG::OPEN_FAILED " << path_.string() << std::endl;
+        return;
+    }
+    std::fwrite(Magic, 1, sizeof(Magic), file_);
+    std::fwrite(&Version, sizeof(Version), 1, file_);
+    bytes_ = HeaderBytes;
+}
+
+InputRecorder::~InputRecorder() {
+    if (file_)
+        std::fclose(file_);
+}
+
+void InputRecorder::frame(float delta_time) {
+    write(InputEvent::Type::Frame, &delta_time, sizeof(delta_time));
+    frames_++;
+}
+
+void InputRecorder::cursor(float x, float y) {
+    const float payload[] = {x, y};
+    write(InputEvent::Type::Cursor, payload, sizeof(payload));
+    events_++;
+}
+
+void InputRecorder::button(int button, int action, int mods) {
+    const uint8_t payload[] = {uint8_t(button), uint8_t(action), uint8_t(mods)};
+    write(InputEvent::Type::Button, payload, sizeof(payload));
+    events_++;
+}
+
+void InputRecorder::scroll(float x, float y) {
+    const float payload[] = {x, y};
+    write(InputEvent::Type::Scroll, payload, sizeof(payload));
+    events_++;
+}
+
+void InputRecorder::key(int key, int action, int mods) {
+    uint8_t payload[sizeof(int16_t) + 2];
+    const auto code = int16_t(key);
+    std::memcpy(payload, &code, sizeof(code));
+    payload[sizeof(code)]     = uint8_t(action);
+    payload[sizeof(code) + 1] = uint8_t(mods);
+    write(InputEvent::Type::Key, payload, sizeof(payload));
+    events_++;
+}
+
+void InputRecorder::finish(uint64_t height_hash) {
+    write(InputEvent::Type::End, &height_hash, sizeof(height_hash));
+    if (file_ && std::fclose(file_) != 0)
+        std::cout << "ERROR::INPUT_LOG::WRITE_FAILED " << path_.string() << std::endl;
+    file_ = nullptr;
+}
+
+void InputRecorder::write(InputEvent::Type type, const void* payload, size_t size) {
+    if (!file_)
+        return;
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::microseconds>(now - last_).count();
+    const auto delta = uint32_t(std::min<int64_t>(elapsed, UINT32_MAX));
+    // Time not written out is carried over to the next record.
+    last_ += std::chrono::microseconds{delta};
+
+    uint8_t record[RecordBytes + sizeof(uint64_t)];
+    record[0] = uint8_t(type);
+    std::memcpy(record + 1, &delta, sizeof(delta));
+    std::memcpy(record + RecordBytes, payload, size);
+    // Buffered by stdio; the frame pays for a copy, not a system call.
+    std::fwrite(record, 1, RecordBytes + size, file_);
+    bytes_ += RecordBytes + size;
+}
+
+InputReplay::InputReplay(const std::filesystem::path& path) {
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        std::cout << "ERROR::INPUT_LOG::NOT_FOUND " << path.string() << std::endl;
+        return;
+    }
+    std::vector<uint8_t> bytes(
+        std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+    if (std::size(bytes) < HeaderBytes
+        || std::memcmp(std::data(bytes), Magic, sizeof(Magic)) != 0) {
+        std::cout << "ERROR::INPUT_LOG::BAD_MAGIC " << path.string() << std::endl;
+        return;
+    }
+    const uint8_t* header = std::data(bytes) + sizeof(Magic);
+    if (const auto version = get<uint32_t>(header); version != Version) {
+        std::cout << "ERROR::INPUT_LOG::UNSUPPORTED_VERSION " << version << " " << path.string()
+                  << std::endl;
+        return;
+    }
+
+    auto time   = uint64_t{};
+    auto offset = HeaderBytes;
+    while (offset + RecordBytes <= std::size(bytes)) {
+        const uint8_t* record = std::data(bytes) + offset;
+        const auto type       = InputEvent::Type(get<uint8_t>(record));
+        if (type > InputEvent::Type::End
+            || offset + RecordBytes + payloadBytes(type) > std::size(bytes))
+            break;
+        time += get<uint32_t>(record);
+        offset += RecordBytes + payloadBytes(type);
+
+        auto event = InputEvent{};
+        event.type = type;
+        event.time = time;
+        switch (type) {
+        case InputEvent::Type::Frame:
+            event.x = get<float>(record);
+            frames_.push_back(std::size(events_));
+            break;
+        case InputEvent::Type::Cursor:
+        case InputEvent::Type::Scroll:
+            event.x = get<float>(record);
+            event.y = get<float>(record);
+            break;
+        case InputEvent::Type::Button:
+            event.code   = get<uint8_t>(record);
+            event.action = get<uint8_t>(record);
+            event.mods   = get<uint8_t>(record);
+            break;
+        case InputEvent::Type::Key:
+            event.code   = get<int16_t>(record);
+            event.action = get<uint8_t>(record);
+            event.mods   = get<uint8_t>(record);
+            break;
+        case InputEvent::Type::End:
+            height_hash_ = get<uint64_t>(record);
+            break;
+        }
+        if (type == InputEvent::Type::End)
+            break;
+        // Events before the first frame have no frame to be dispatched in.
+        if (!std::empty(frames_))
+            events_.push_back(event);
+    }
+    if (offset < std::size(bytes) && !height_hash_)
+        std::cout << "ERROR::INPUT_LOG::TRUNCATED " << path.string() << " at " << offset
+                  << std::endl;
+    open_ = true;
+}
+
+std::optional<float> InputReplay::nextFrame(bool real_time) {
+    if (frame_ == std::size(frames_))
+        return std::nullopt;
+    const auto& frame = events_[frames_[frame_++]];
+    if (frame_ == 1)
+        start_ = std::chrono::steady_clock::now();
+    else if (real_time)
+        std::this_thread::sleep_until(
+            start_ + std::chrono::microseconds{frame.time - events_[frames_[0]].time});
+    return frame.x;
+}
+
+std::span<const InputEvent> InputReplay::getFrameEvents() const {
+    if (frame_ == 0)
+        return {};
+    const auto first = frames_[frame_ - 1] + 1;
+    const auto last  = frame_ < std::size(frames_) ? frames_[frame_] : std::size(events_);
+    return {std::data(events_) + first, last - first};
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+// Raw input of an editing session, recorded to replay it later as a benchmark.
+//
+// A log is a header and a stream of records, each a type byte and the microseconds since the
+// previous record. A frame record carries the frame's time step and is followed by the events
+// GLFW dispatched during that frame: cursor positions, mouse buttons, scroll offsets and keys.
+// Positions and offsets are stored as the floats the editor's callbacks receive, so dispatching
+// them again through the same callbacks repeats the session exactly. The log ends with a hash of
+// the map's heights, which a replay compares its own against.
+struct InputEvent {
+    enum class Type : uint8_t { Frame, Cursor, Button, Scroll, Key, End };
+
+    Type type;
+    // Microseconds since the log started.
+    uint64_t time;
+    // Cursor position or scroll offset; a frame's time step is in x.
+    float x, y;
+    // Button or key, action and modifiers.
+    int32_t code, action, mods;
+};
+
+class InputRecorder {
+  public:
+    explicit InputRecorder(std::filesystem::path path);
+    // Closes the log without a final hash if finish was not called.
+    ~InputRecorder();
+    InputRecorder(const InputRecorder&)            = delete;
+    InputRecorder& operator=(const InputRecorder&) = delete;
+
+    bool isOpen() const { return file_ != nullptr; }
+
+    void frame(float delta_time);
+    void cursor(float x, float y);
+    void button(int button, int action, int mods);
+    void scroll(float x, float y);
+    void key(int key, int action, int mods);
+    // Ends the log with the hash of the heights the session left.
+    void finish(uint64_t height_hash);
+
+    uint64_t getFrames() const { return frames_; }
+    uint64_t getEvents() const { return events_; }
+    uint64_t getBytes() const { return bytes_; }
+
+  private:
+    void write(InputEvent::Type type, const void* payload, size_t size);
+
+    std::filesystem::path path_;
+    std::FILE* file_ = nullptr;
+    std::chrono::steady_clock::time_point last_;
+    uint64_t frames_ = 0;
+    uint64_t events_ = 0;
+    uint64_t bytes_  = 0;
+};
+
+class InputReplay {
+  public:
+    // Reads the whole log; a log cut short replays up to its last whole record.
+    explicit InputReplay(const std::filesystem::path& path);
+
+    bool isOpen() const { return open_; }
+
+    // Moves to the next recorded frame and returns its time step, or nothing past the last one.
+    // In real time, first sleeps until the frame is as far from the first as when recorded.
+    std::optional<float> nextFrame(bool real_time);
+    // The events dispatched during the current frame.
+    std::span<const InputEvent> getFrameEvents() const;
+
+    // The hash the recording ended with, if it was finished.
+    std::optional<uint64_t> getHeightHash() const { return height_hash_; }
+    size_t getFrames() const { return std::size(frames_); }
+    size_t getEvents() const { return std::size(events_) - std::size(frames_); }
+
+  private:
+    bool open_ = false;
+    std::vector<InputEvent> events_;
+    // Index of each frame record in events_.
+    std::vector<size_t> frames_;
+    size_t frame_ = 0;
+    std::optional<uint64_t> height_hash_;
+    std::chrono::steady_clock::time_point start_;
+};
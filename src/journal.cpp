@@ -0,0 +1,335 @@
+#include "journal.hpp"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "profiler.hpp"
+
+namespace {
+constexpr char Magic[4]      = {'T', 'V', 'J', 'L'};
+// Version 2 added the map's width and height to the header.
+constexpr uint32_t Version   = 2;
+constexpr uint8_t TileRecord = 0;
+// Layer settings: layer, blend, visible, opacity.
+constexpr uint8_t LayerRecord = 1;
+// Magic, version, tile size, width and height.
+constexpr size_t HeaderBytes  = sizeof(Magic) + 4 * sizeof(uint32_t);
+// Compaction starts once the journal outgrows twice the live layers by this much.
+constexpr uint64_t CompactionSlack = uint64_t{64} << 20;
+
+uint32_t crc32(const uint8_t* data, size_t size) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> table{};
+        for (auto i = uint32_t{}; i < 256; i++) {
+            auto crc = i;
+            for (auto bit = 0; bit < 8; bit++)
+                crc = crc & 1 ? 0xedb88320u ^ (crc >> 1) : crc >> 1;
+            table[i] = crc;
+        }
+        return table;
+    }();
+    auto crc = ~uint32_t{};
+    for (auto i = size_t{}; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+template <typename T>
+void put(std::vector<uint8_t>& out, const T& value) {
+    const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+T get(const uint8_t*& in) {
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+}
+
+// Frames a record as crc | size | payload.
+void appendRecord(std::vector<uint8_t>& out, const std::vector<uint8_t>& payload) {
+    put(out, crc32(std::data(payload), std::size(payload)));
+    put(out, uint32_t(std::size(payload)));
+    out.insert(out.end(), payload.begin(), payload.end());
+}
+
+void encodeSettings(std::vector<uint8_t>& out, const LayerStack::Snapshot& snapshot) {
+    std::vector<uint8_t> payload;
+    for (auto layer = size_t{}; layer < LayerStack::Count; layer++) {
+        auto& state = snapshot.layers[layer];
+        payload.clear();
+        put(payload, LayerRecord);
+        put(payload, uint8_t(layer));
+        put(payload, uint8_t(state.blend));
+        put(payload, uint8_t(state.visible));
+        put(payload, state.opacity);
+        appendRecord(out, payload);
+    }
+}
+
+void encodeTile(
+    std::vector<uint8_t>& out, size_t layer, uint64_t key, const float* samples, size_t count) {
+    std::vector<uint8_t> payload;
+    payload.reserve(2 + sizeof(key) + count * sizeof(float));
+    put(payload, TileRecord);
+    put(payload, uint8_t(layer));
+    put(payload, key);
+    const auto bytes = reinterpret_cast<const uint8_t*>(samples);
+    payload.insert(payload.end(), bytes, bytes + count * sizeof(float));
+    appendRecord(out, payload);
+}
+
+bool sync(std::FILE* file) {
+    if (std::fflush(file) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+} // namespace
+
+Journal::Journal(std::filesystem::path path, LayerStack& layers)
+  : path_{std::move(path)}, layers_{layers}, tile_size_{layers.getFile().getTileSize()},
+    width_{layers.getFile().getWidth()}, height_{layers.getFile().getHeight()} {
+    replay();
+    // Replayed edits are already in the journal.
+    layers_.takeChanges();
+    if (open("ab"))
+        worker_ = std::thread{[this] { run(); }};
+}
+
+Journal::~Journal() {
+    if (!worker_.joinable())
+        return;
+    checkpoint();
+    {
+        std::lock_guard lock{mutex_};
+        stop_ = true;
+    }
+    condition_.notify_one();
+    worker_.join();
+    if (file_)
+        std::fclose(file_);
+}
+
+void Journal::update(float delta_time) {
+    elapsed_ += delta_time;
+    if (elapsed_ >= Interval) {
+        elapsed_ = 0.0f;
+        checkpoint();
+    }
+}
+
+void Journal::checkpoint() {
+    auto changes = layers_.takeChanges();
+    if (!worker_.joinable() || (changes.tiles.empty() && !changes.settings))
+        return;
+    {
+        std::lock_guard lock{mutex_};
+        if (failed_)
+            return;
+        jobs_.push_back({layers_.snapshot(), std::move(changes.tiles)});
+    }
+    condition_.notify_one();
+}
+
+Journal::Stats Journal::getStats() const {
+    std::lock_guard lock{mutex_};
+    return stats_;
+}
+
+void Journal::replay() {
+    std::ifstream in{path_, std::ios::binary};
+    if (!in)
+        return;
+    std::vector<uint8_t> bytes(
+        std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+    in.close();
+
+    auto compatible = std::size(bytes) >= HeaderBytes
+                      && std::memcmp(std::data(bytes), Magic, sizeof(Magic)) == 0;
+    if (compatible) {
+        const uint8_t* header = std::data(bytes) + sizeof(Magic);
+        compatible = get<uint32_t>(header) == Version && get<uint32_t>(header) == tile_size_
+                     && get<uint32_t>(header) == width_ && get<uint32_t>(header) == height_;
+    }
+    if (!compatible) {
+        // Keep it for inspection rather than replaying it over the wrong map.
+        std::cout << "ERROR::JOURNAL::INCOMPATIBLE " << path_.string() << std::endl;
+        std::error_code error;
+        std::filesystem::rename(path_, std::filesystem::path{path_}.concat(".bad"), error);
+        return;
+    }
+
+    const auto tile_samples = size_t(tile_size_) * tile_size_;
+    const auto& map         = layers_.getFile();
+    auto records            = uint64_t{};
+    auto offset             = HeaderBytes;
+    while (offset + 2 * sizeof(uint32_t) <= std::size(bytes)) {
+        const uint8_t* record = std::data(bytes) + offset;
+        const auto crc        = get<uint32_t>(record);
+        const auto size       = get<uint32_t>(record);
+        const auto start      = record;
+        if (size < 2 || offset + 2 * sizeof(uint32_t) + size > std::size(bytes)
+            || crc32(start, size) != crc)
+            break;
+
+        const auto type  = get<uint8_t>(record);
+        const auto layer = get<uint8_t>(record);
+        if (layer >= LayerStack::Count)
+            break;
+        if (type == TileRecord && size == 2 + sizeof(uint64_t) + tile_samples * sizeof(float)) {
+            const auto key = get<uint64_t>(record);
+            if (uint32_t(key) >= map.getTilesX() || uint32_t(key >> 32) >= map.getTilesY())
+                break;
+            std::memcpy(
+                layers_.edit(layer, uint32_t(key), uint32_t(key >> 32)),
+                record,
+                tile_samples * sizeof(float));
+        } else if (type == LayerRecord && size == 4 + sizeof(float)) {
+            const auto blend   = get<uint8_t>(record);
+            const auto visible = get<uint8_t>(record);
+            if (blend > uint8_t(LayerStack::Blend::Min))
+                break;
+            layers_.setBlend(layer, LayerStack::Blend(blend));
+            layers_.setVisible(layer, visible != 0);
+            layers_.setOpacity(layer, get<float>(record));
+        } else {
+            break;
+        }
+        offset += 2 * sizeof(uint32_t) + size;
+        records++;
+    }
+
+    if (offset < std::size(bytes)) {
+        std::cout << "ERROR::JOURNAL::TRUNCATED " << path_.string() << " at " << offset
+                  << std::endl;
+        std::error_code error;
+        std::filesystem::resize_file(path_, offset, error);
+    }
+    stats_.replayed_records = records;
+}
+
+std::vector<uint8_t> Journal::encodeHeader() const {
+    std::vector<uint8_t> header{std::begin(Magic), std::end(Magic)};
+    put(header, Version);
+    put(header, tile_size_);
+    put(header, width_);
+    put(header, height_);
+    return header;
+}
+
+bool Journal::open(const char* mode) {
+    file_ = std::fopen(path_.string().c_str(), mode);
+    if (!file_) {
+        std::cout << "ERROR::JOURNAL::OPEN_FAILED " << path_.string() << std::endl;
+        return false;
+    }
+    std::fseek(file_, 0, SEEK_END);
+    bytes_ = uint64_t(std::ftell(file_));
+    if (bytes_ == 0) {
+        const auto header = encodeHeader();
+        std::fwrite(std::data(header), 1, std::size(header), file_);
+        bytes_ = std::size(header);
+    }
+    return true;
+}
+
+void Journal::write(const Job& job) {
+    std::vector<uint8_t> out;
+    auto tiles = uint64_t{};
+    for (auto& [layer, key] : job.tiles) {
+        if (auto samples = job.snapshot.layers[layer].tiles.find(key)) {
+            encodeTile(out, layer, key, samples, size_t(tile_size_) * tile_size_);
+            tiles++;
+        }
+    }
+    encodeSettings(out, job.snapshot);
+    if (std::fwrite(std::data(out), 1, std::size(out), file_) != std::size(out) || !sync(file_))
+        std::cout << "ERROR::JOURNAL::WRITE_FAILED " << path_.string() << std::endl;
+    bytes_ += std::size(out);
+
+    std::lock_guard lock{mutex_};
+    stats_.checkpoints++;
+    stats_.tiles_written += tiles;
+    stats_.bytes = bytes_;
+}
+
+// Rewrites the journal as one checkpoint of every live tile and swaps it in atomically.
+void Journal::compact(const LayerStack::Snapshot& snapshot) {
+    auto live = uint64_t{};
+    for (auto& layer : snapshot.layers)
+        live += std::size(layer.tiles) * (size_t(tile_size_) * tile_size_ * sizeof(float));
+    if (bytes_ <= 2 * live + CompactionSlack)
+        return;
+
+    const auto temporary = std::filesystem::path{path_}.concat(".tmp");
+    auto file            = std::fopen(temporary.string().c_str(), "wb");
+    if (!file)
+        return;
+    auto out = encodeHeader();
+    for (auto layer = size_t{}; layer < LayerStack::Count; layer++) {
+        for (auto& [key, tile] : snapshot.layers[layer].tiles)
+            encodeTile(out, layer, key, std::data(*tile), std::size(*tile));
+    }
+    encodeSettings(out, snapshot);
+    const auto written = std::fwrite(std::data(out), 1, std::size(out), file) == std::size(out)
+                         && sync(file);
+    std::fclose(file);
+
+    std::error_code error;
+    if (written)
+        std::filesystem::rename(temporary, path_, error);
+    if (!written || error) {
+        std::cout << "ERROR::JOURNAL::COMPACTION_FAILED " << path_.string() << std::endl;
+        std::filesystem::remove(temporary, error);
+        return;
+    }
+    std::fclose(file_);
+    open("ab");
+
+    std::lock_guard lock{mutex_};
+    stats_.compactions++;
+    stats_.bytes = bytes_;
+}
+
+void Journal::run() {
+    PROFILE_THREAD("Journal");
+    while (true) {
+        std::unique_lock lock{mutex_};
+        condition_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+        if (jobs_.empty())
+            return;
+        auto job = std::move(jobs_.front());
+        jobs_.pop_front();
+        lock.unlock();
+
+        PROFILE_ZONE("Journal::checkpoint");
+        write(job);
+        if (file_)
+            compact(job.snapshot);
+        if (!file_) {
+            // The journal could not be reopened after compaction. Queued checkpoints would keep
+            // their snapshots' tiles shared, and with them every later edit copying its tile.
+            lock.lock();
+            failed_ = true;
+            jobs_.clear();
+            std::cout << "ERROR::JOURNAL::STOPPED " << path_.string() << std::endl;
+            return;
+        }
+    }
+}
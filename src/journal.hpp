@@ -0,0 +1,78 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "layer_stack.hpp"
+
+// Crash-recovery journal of the layers over a map.
+//
+// Every Interval seconds the layer tiles edited since the previous checkpoint, and the layer
+// settings, are appended as CRC-checked records to `<map>.journal`. The frame only pays for a
+// LayerStack snapshot; a worker thread writes and fsyncs the records. On open the journal is
+// replayed over the map, stopping at the first torn or corrupt record or tile outside the map; a
+// journal written for a map of another size or tile size is renamed aside with a .bad suffix.
+// Once the journal holds much more than the live layers, the worker rewrites it as a single
+// checkpoint.
+class Journal {
+  public:
+    struct Stats {
+        uint64_t checkpoints;
+        uint64_t tiles_written;
+        uint64_t replayed_records;
+        uint64_t compactions;
+        uint64_t bytes;
+    };
+
+    static constexpr float Interval = 2.0f;
+
+    Journal(std::filesystem::path path, LayerStack& layers);
+    Journal(const Journal&)            = delete;
+    Journal& operator=(const Journal&) = delete;
+    // Writes a final checkpoint.
+    ~Journal();
+
+    void update(float delta_time);
+    void checkpoint();
+
+    Stats getStats() const;
+
+  private:
+    struct Job {
+        LayerStack::Snapshot snapshot;
+        std::vector<std::pair<size_t, uint64_t>> tiles;
+    };
+
+    void replay();
+    std::vector<uint8_t> encodeHeader() const;
+    bool open(const char* mode);
+    void write(const Job& job);
+    void compact(const LayerStack::Snapshot& snapshot);
+    void run();
+
+    std::filesystem::path path_;
+    LayerStack& layers_;
+    uint32_t tile_size_;
+    uint32_t width_;
+    uint32_t height_;
+    float elapsed_ = 0.0f;
+
+    // Owned by the worker once it runs.
+    std::FILE* file_ = nullptr;
+    uint64_t bytes_  = 0;
+
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    std::deque<Job> jobs_;
+    Stats stats_{};
+    bool stop_   = false;
+    // The worker lost the journal; checkpoints are dropped.
+    bool failed_ = false;
+    std::thread worker_;
+};
@@ -0,0 +1,237 @@
+#include "layer_stack.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LAYER_STACK_SSE2
+#endif
+
+namespace {
+using Blend = LayerStack::Blend;
+
+template <Blend B>
+float target(float below, float layer) {
+    if constexpr (B == Blend::Normal)
+        return layer;
+    else if constexpr (B == Blend::Add)
+        return below + layer;
+    else if constexpr (B == Blend::Max)
+        return std::max(below, layer);
+    else
+        return std::min(below, layer);
+}
+
+// out = mix(out, target(out, layer), opacity) wherever the layer is not NaN.
+template <Blend B>
+void blendRow(float opacity, const float* layer, float* out, size_t count) {
+    auto i = size_t{};
+#ifdef LAYER_STACK_SSE2
+    const auto o = _mm_set1_ps(opacity);
+    for (; i + 4 <= count; i += 4) {
+        const auto l = _mm_loadu_ps(layer + i);
+        const auto c = _mm_loadu_ps(out + i);
+        __m128 t;
+        if constexpr (B == Blend::Normal)
+            t = l;
+        else if constexpr (B == Blend::Add)
+            t = _mm_add_ps(c, l);
+        else if constexpr (B == Blend::Max)
+            t = _mm_max_ps(c, l);
+        else
+            t = _mm_min_ps(c, l);
+        const auto mixed   = _mm_add_ps(c, _mm_mul_ps(o, _mm_sub_ps(t, c)));
+        const auto covered = _mm_cmpord_ps(l, l);
+        _mm_storeu_ps(out + i, _mm_or_ps(_mm_and_ps(covered, mixed), _mm_andnot_ps(covered, c)));
+    }
+#endif
+    for (; i < count; i++) {
+        if (layer[i] == layer[i])
+            out[i] += opacity * (target<B>(out[i], layer[i]) - out[i]);
+    }
+}
+
+void blendRow(Blend blend, float opacity, const float* layer, float* out, size_t count) {
+    switch (blend) {
+    case Blend::Normal:
+        return blendRow<Blend::Normal>(opacity, layer, out, count);
+    case Blend::Add:
+        return blendRow<Blend::Add>(opacity, layer, out, count);
+    case Blend::Max:
+        return blendRow<Blend::Max>(opacity, layer, out, count);
+    case Blend::Min:
+        return blendRow<Blend::Min>(opacity, layer, out, count);
+    }
+}
+} // namespace
+
+std::vector<uint64_t> LayerStack::Snapshot::getKeys() const {
+    std::vector<uint64_t> keys;
+    for (auto& layer : layers) {
+        for (auto& [key, tile] : layer.tiles)
+            keys.push_back(key);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+void LayerStack::Snapshot::composite(
+    uint64_t key, const float* base, float* out, Rect rect) const {
+    const auto width = size_t(rect.x1 - rect.x0);
+    for (auto y = rect.y0; y < rect.y1; y++) {
+        const auto row = size_t(y) * tile_size + rect.x0;
+        std::memcpy(out + row, base + row, width * sizeof(float));
+    }
+    for (auto& layer : layers) {
+        if (!layer.visible || layer.opacity <= 0.0f)
+            continue;
+        if (auto tile = layer.tiles.find(key)) {
+            for (auto y = rect.y0; y < rect.y1; y++) {
+                const auto row = size_t(y) * tile_size + rect.x0;
+                blendRow(layer.blend, layer.opacity, tile + row, out + row, width);
+            }
+        }
+    }
+}
+
+LayerStack::LayerStack(TileCache& base, size_t composite_budget)
+  : base_{base}, tile_size_{int(base.getFile().getTileSize())},
+    composite_budget_{composite_budget} {
+    state_.tile_size = tile_size_;
+    for (auto& layer : state_.layers)
+        layer.tiles = TileStore{size_t(tile_size_) * tile_size_};
+}
+
+const float* LayerStack::read(uint32_t tx, uint32_t ty) {
+    const auto key = TileKey(tx, ty);
+    auto found     = composite_.find(key);
+    if (found == std::end(composite_)) {
+        if (!covers(key))
+            return base_.read(tx, ty);
+        // Dropped by update(); blend it again.
+        invalidate(key, Full);
+        found = composite_.find(key);
+    }
+
+    auto& [samples, dirty, lru] = found->second;
+    lru_.splice(lru_.begin(), lru_, lru);
+    if (dirty.x0 < dirty.x1 && dirty.y0 < dirty.y1) {
+        state_.composite(key, base_.read(tx, ty), std::data(samples), dirty);
+        composited_samples_ += size_t(dirty.x1 - dirty.x0) * size_t(dirty.y1 - dirty.y0);
+        dirty = {};
+    }
+    return std::data(samples);
+}
+
+float* LayerStack::edit(size_t layer, uint32_t tx, uint32_t ty, Rect dirty) {
+    const auto key = TileKey(tx, ty);
+    invalidate(key, dirty);
+    edited_[layer].insert(key);
+    return state_.layers[layer].tiles.write(key, std::numeric_limits<float>::quiet_NaN());
+}
+
+const float* LayerStack::find(size_t layer, uint32_t tx, uint32_t ty) const {
+    return state_.layers[layer].tiles.find(TileKey(tx, ty));
+}
+
+LayerStack::Changes LayerStack::takeChanges() {
+    Changes changes{{}, std::exchange(settings_changed_, false)};
+    for (auto layer = size_t{}; layer < Count; layer++) {
+        for (auto key : edited_[layer])
+            changes.tiles.emplace_back(layer, key);
+        edited_[layer].clear();
+    }
+    return changes;
+}
+
+void LayerStack::setVisible(size_t layer, bool visible) {
+    if (state_.layers[layer].visible != visible) {
+        state_.layers[layer].visible = visible;
+        invalidateLayer(layer);
+        settings_changed_ = true;
+    }
+}
+
+void LayerStack::setOpacity(size_t layer, float opacity) {
+    opacity = std::clamp(opacity, 0.0f, 1.0f);
+    if (state_.layers[layer].opacity != opacity) {
+        state_.layers[layer].opacity = opacity;
+        invalidateLayer(layer);
+        settings_changed_ = true;
+    }
+}
+
+void LayerStack::setBlend(size_t layer, Blend blend) {
+    if (state_.layers[layer].blend != blend) {
+        state_.layers[layer].blend = blend;
+        invalidateLayer(layer);
+        settings_changed_ = true;
+    }
+}
+
+void LayerStack::update() {
+    const auto tile_bytes = size_t(tile_size_) * tile_size_ * sizeof(float);
+    while (std::size(composite_) * tile_bytes > composite_budget_ && !lru_.empty()) {
+        composite_.erase(lru_.back());
+        lru_.pop_back();
+        composite_evictions_++;
+    }
+}
+
+LayerStack::Stats LayerStack::getStats() const {
+    Stats stats{};
+    for (auto& layer : state_.layers) {
+        const auto tiles = layer.tiles.getStats();
+        stats.layer_tiles += tiles.tiles;
+        stats.shared_tiles += tiles.shared_tiles;
+        stats.copied_tiles += tiles.copies;
+    }
+    stats.composite_tiles     = std::size(composite_);
+    stats.composited_samples  = composited_samples_;
+    stats.composite_evictions = composite_evictions_;
+    return stats;
+}
+
+bool LayerStack::covers(uint64_t key) const {
+    return std::any_of(state_.layers.begin(), state_.layers.end(), [key](auto& layer) {
+        return layer.tiles.find(key) != nullptr;
+    });
+}
+
+void LayerStack::invalidate(uint64_t key, Rect rect) {
+    rect = {
+        std::max(rect.x0, 0),
+        std::max(rect.y0, 0),
+        std::min(rect.x1, tile_size_),
+        std::min(rect.y1, tile_size_)};
+    auto [found, inserted]      = composite_.try_emplace(key);
+    auto& [samples, dirty, lru] = found->second;
+    if (inserted) {
+        samples.resize(size_t(tile_size_) * tile_size_);
+        dirty = {0, 0, tile_size_, tile_size_};
+        lru_.push_front(key);
+        lru = lru_.begin();
+        return;
+    }
+    lru_.splice(lru_.begin(), lru_, lru);
+    if (rect.x0 >= rect.x1 || rect.y0 >= rect.y1)
+        return;
+    if (dirty.x0 >= dirty.x1 || dirty.y0 >= dirty.y1) {
+        dirty = rect;
+    } else {
+        dirty = {
+            std::min(dirty.x0, rect.x0),
+            std::min(dirty.y0, rect.y0),
+            std::max(dirty.x1, rect.x1),
+            std::max(dirty.y1, rect.y1)};
+    }
+}
+
+void LayerStack::invalidateLayer(size_t layer) {
+    for (auto& [key, tile] : state_.layers[layer].tiles)
+        invalidate(key, Full);
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <climits>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "tile_cache.hpp"
+#include "tile_store.hpp"
+
+// Non-destructive height layers over the base map in a TileCache.
+//
+// Each layer is a sparse set of tiles with its own blend mode, opacity and visibility; samples a
+// layer never wrote are NaN and leave the heights below unchanged. The base is the bottom of the
+// stack and stays untouched. Tiles no layer covers are read straight from the base; the others
+// keep a cached composite whose dirty rectangle is blended again on the next read, so an edit or
+// a layer toggle only costs the samples it affects and is paid lazily for the tiles in view.
+// Composites are a cache: update() drops the least recently used beyond the composite budget and
+// a read of a dropped one blends it again in full. The layer tiles themselves are the edits and
+// are only ever freed by rewriting them transparent; they grow with the area edited, not with
+// the map, and are what the journal and an export persist. The base never sees a layer edit, so
+// the base cache never has a dirty tile of its own to write back for a composited tile.
+// Layer tiles are copy-on-write, so snapshot() hands out a frozen copy of every layer for a
+// background export or analysis at the cost of a pointer copy per tile.
+class LayerStack {
+  public:
+    enum Layer : size_t { Sculpt, Stamps, Erosion, Count };
+    enum class Blend { Normal, Add, Max, Min };
+
+    // Tile-local sample rectangle, [x0, x1) x [y0, y1).
+    struct Rect {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+    };
+    static constexpr Rect Full = {0, 0, INT_MAX, INT_MAX};
+
+    struct LayerState {
+        TileStore tiles;
+        Blend blend   = Blend::Normal;
+        float opacity = 1.0f;
+        bool visible  = true;
+    };
+
+    struct Snapshot {
+        int tile_size;
+        std::array<LayerState, Count> layers;
+
+        // Tiles any layer covers.
+        std::vector<uint64_t> getKeys() const;
+        // Blends the layers over `base` into `out` within `rect`; both hold whole tiles.
+        void composite(uint64_t key, const float* base, float* out, Rect rect) const;
+    };
+
+    // Edits since the last takeChanges(): layer tiles as (layer, key), and whether any blend
+    // mode, opacity or visibility changed.
+    struct Changes {
+        std::vector<std::pair<size_t, uint64_t>> tiles;
+        bool settings;
+    };
+
+    struct Stats {
+        size_t layer_tiles;
+        // Layer tiles still shared with a live snapshot, and tiles copied on write.
+        size_t shared_tiles;
+        uint64_t copied_tiles;
+        size_t composite_tiles;
+        uint64_t composited_samples;
+        uint64_t composite_evictions;
+    };
+
+    static constexpr size_t DefaultCompositeBudget = size_t{64} << 20;
+
+    explicit LayerStack(TileCache& base, size_t composite_budget = DefaultCompositeBudget);
+
+    // The composited tile; valid until the next edit or update() of the stack or update of the
+    // base cache.
+    const float* read(uint32_t tx, uint32_t ty);
+    // A layer's tile for writing, created transparent. `dirty` bounds the samples about to change.
+    float* edit(size_t layer, uint32_t tx, uint32_t ty, Rect dirty = Full);
+    // A layer's tile, or null if the layer never wrote it.
+    const float* find(size_t layer, uint32_t tx, uint32_t ty) const;
+
+    const TileFile& getFile() const { return base_.getFile(); }
+    Snapshot snapshot() const { return state_; }
+    Changes takeChanges();
+
+    // Drops least recently read or edited composites until they fit into the budget.
+    void update();
+
+    bool isVisible(size_t layer) const { return state_.layers[layer].visible; }
+    void setVisible(size_t layer, bool visible);
+    void setOpacity(size_t layer, float opacity);
+    void setBlend(size_t layer, Blend blend);
+
+    Stats getStats() const;
+
+  private:
+    struct Composite {
+        std::vector<float> samples;
+        Rect dirty;
+        // Position in lru_.
+        std::list<uint64_t>::iterator lru;
+    };
+
+    bool covers(uint64_t key) const;
+    void invalidate(uint64_t key, Rect rect);
+    void invalidateLayer(size_t layer);
+
+    TileCache& base_;
+    int tile_size_;
+    Snapshot state_;
+    size_t composite_budget_;
+    std::unordered_map<uint64_t, Composite> composite_;
+    std::list<uint64_t> lru_;
+    std::array<std::unordered_set<uint64_t>, Count> edited_;
+    bool settings_changed_       = false;
+    uint64_t composited_samples_  = 0;
+    uint64_t composite_evictions_ = 0;
+};
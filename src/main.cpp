@@ -1,7 +1,10 @@
 #define STB_IMAGE_IMPLEMENTATION
 
+#include <algorithm>
 #include <functional>
 #include <iostream>
+#include <optional>
+#include <string_view>
 
 #include <glad/glad.h>
 
@@ -13,15 +16,30 @@
 #include "learnopengl/camera.hpp"
 #include "learnopengl/shader.hpp"
 
+#include "allocation_counter.hpp"
+#include "benchmarks.hpp"
 #include "circle.hpp"
 #include "cursor.hpp"
 #include "editor.hpp"
+#include "editor_metrics.hpp"
+#include "gl_calls.hpp"
+#include "gl_object.hpp"
+#include "gl_state.hpp"
+#include "hud.hpp"
+#include "input_latency.hpp"
+#include "input_log.hpp"
 #include "mouse.hpp"
+#include "profiler.hpp"
+#include "scratch_map.hpp"
+#include "startup_timeline.hpp"
+#include "stress.hpp"
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void dispatch(GLFWwindow* window, const InputEvent& event);
 void processInput(GLFWwindow* window);
 
 // settings
@@ -31,6 +49,7 @@ static constexpr auto SCR_HEIGHT = 600;
 static auto mouseMovementCallbacks = std::vector<std::function<void(float, float)>>();
 static auto mouseScrollCallbacks   = std::vector<std::function<void(float, float)>>();
 static auto mouseButtonCallbacks   = std::vector<std::function<void(int, int, int)>>();
+static auto keyCallbacks           = std::vector<std::function<void(int, int, int)>>();
 
 // timing
 float deltaTime = 0.0f;
@@ -40,10 +59,44 @@ Mouse::StateMachine mouse_state;
 
 
 int main(int argv, char* argc[]) {
+    if (argv > 1 && std::string_view{argc[1]} == "--bench")
+        return RunBenchmark(argv - 2, argc + 2);
+    PROFILE_THREAD("Main");
+    // --metrics <file> writes the session's metrics every ten seconds: Prometheus text to a .prom
+    // file, JSON lines to any other. --record <file> logs the session's input; --replay <file>
+    // plays a log back at its recorded pace instead of taking input, or with --fast as fast as
+    // possible in a hidden window, and checks that it ends with the recorded heights. --stress
+    // <workload> [options] runs a synthetic load in a hidden window instead; see RunStress.
+    auto metrics_path = std::filesystem::path{};
+    auto record_path  = std::filesystem::path{};
+    auto replay_path  = std::filesystem::path{};
+    auto fast         = false;
+    auto stress       = 0;
+    for (auto i = 1; i < argv; i++) {
+        const auto arg = std::string_view{argc[i]};
+        if (arg == "--metrics" && i + 1 < argv)
+            metrics_path = argc[++i];
+        else if (arg == "--record" && i + 1 < argv)
+            record_path = argc[++i];
+        else if (arg == "--replay" && i + 1 < argv)
+            replay_path = argc[++i];
+        else if (arg == "--fast")
+            fast = true;
+        else if (arg == "--stress") {
+            stress = i + 1;
+            break;
+        }
+    }
+    auto replay = std::optional<InputReplay>{};
+    if (!replay_path.empty() && !replay.emplace(replay_path).isOpen())
+        return -1;
+    fast = fast && replay;
+    StartupTimeline startup;
 
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
+    startup.mark("GLFW");
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -51,6 +104,8 @@ int main(int argv, char* argc[]) {
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    if (fast || stress)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
 
     // glfw window creation
     // --------------------
@@ -62,12 +117,19 @@ int main(int argv, char* argc[]) {
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetMouseButtonCallback(window, mouse_button_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    // A replay ignores live input but Escape.
+    if (!replay) {
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetMouseButtonCallback(window, mouse_button_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetKeyCallback(window, key_callback);
+
+        // tell GLFW to capture our mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
+    if (fast)
+        glfwSwapInterval(0);
+    startup.mark("Window");
 
     // glad: load all OpenGL function pointers
     // ---------------------------------------
@@ -75,6 +137,11 @@ int main(int argv, char* argc[]) {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    InstallGLStateCache();
+#ifdef GL_CALL_COUNTER
+    InstallGLCallCounter();
+#endif
+    startup.mark("GL loader");
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     // stbi_set_flip_vertically_on_load(true);
@@ -84,121 +151,402 @@ int main(int argv, char* argc[]) {
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (stress) {
+        const auto result = RunStress(argv - stress, argc + stress);
+        glfwTerminate();
+        return result;
+    }
+
+    // Show the window right away; the map loads while the shaders compile and the first frames
+    // are drawn without it.
+    glClearColor(0.0f, 0.0f, 0.5f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glfwSwapBuffers(window);
+    startup.mark("First frame");
 
     // draw in wireframe
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-    Camera camera({0.0f, 3.0f, 10.0f}, {0.0f, 1.0f, 0.0f}, -90.f, -20.0f);
-    Shader cursor_shader("shaders/cursor.vs", "shaders/cursor.fs");
-    Shader triangle_shader("shaders/triangle.vs", "shaders/default.fs");
-    Shader wireframe_shader("shaders/wireframe.vs", "shaders/default.fs", "shaders/wireframe.gs");
-    Editor editor(10, 10, Cursor{0.03, {0.79f, 0.071f, 0.13f}, 0.5f});
-    mouse_state.add(Mouse::State::Default, Mouse::Action::LeftPress, Mouse::State::LeftPressed);
-    mouse_state.add(
-        Mouse::State::LeftPressed, Mouse::Action::LeftRelease, Mouse::State::Default, [&editor] {
-            editor.reset();
+    // Recorded and replayed sessions start from the same flat map, one of their own.
+    auto scratch = std::optional<ScratchMap>{};
+    if ((!record_path.empty() || replay) && !scratch.emplace(10, 10).isOpen()) {
+        glfwTerminate();
+        return -1;
+    }
+
+    auto result = 0;
+    // Everything that owns GL objects is destroyed before glfwTerminate() takes the context.
+    {
+        const auto cursor = Cursor{0.03, {0.79f, 0.071f, 0.13f}, 0.5f};
+        Editor editor = scratch ? Editor(scratch->getPath(), cursor) : Editor(10, 10, cursor);
+        startup.mark("Editor");
+        Camera camera({0.0f, 3.0f, 10.0f}, {0.0f, 1.0f, 0.0f}, -90.f, -20.0f);
+        Shader cursor_shader("shaders/cursor.vs", "shaders/cursor.fs");
+        Shader triangle_shader("shaders/triangle.vs", "shaders/default.fs");
+        Shader wireframe_shader(
+            "shaders/wireframe.vs", "shaders/default.fs", "shaders/wireframe.gs");
+        Shader hud_shader("shaders/hud.vs", "shaders/hud.fs");
+        startup.mark("Shaders");
+        Hud hud;
+        InputLatency input_latency{GlobalMetrics(), editor.getGpuTimer()};
+        EditorMetrics editor_metrics{GlobalMetrics()};
+        auto metrics_exporter = std::optional<MetricsExporter>{};
+        if (!metrics_path.empty())
+            metrics_exporter.emplace(GlobalMetrics(), metrics_path);
+        auto recorder = std::optional<InputRecorder>{};
+        if (!record_path.empty() && recorder.emplace(record_path).isOpen()) {
+            mouseMovementCallbacks.push_back(
+                [&recorder](auto x, auto y) { recorder->cursor(x, y); });
+            mouseScrollCallbacks.push_back(
+                [&recorder](auto x, auto y) { recorder->scroll(x, y); });
+            mouseButtonCallbacks.push_back([&recorder](auto button, auto action, auto mods) {
+                recorder->button(button, action, mods);
+            });
+            keyCallbacks.push_back([&recorder](auto key, auto action, auto mods) {
+                recorder->key(key, action, mods);
+            });
+        }
+        mouse_state.add(
+            Mouse::State::Default, Mouse::Action::LeftPress, Mouse::State::LeftPressed, [&editor] {
+                editor.beginStroke();
+            });
+        mouse_state.add(
+            Mouse::State::LeftPressed,
+            Mouse::Action::LeftRelease,
+            Mouse::State::Default,
+            [&editor] {
+                editor.endStroke();
+                editor.reset();
+            });
+        mouse_state.add(
+            Mouse::State::LeftPressed,
+            Mouse::Action::ScrollUp,
+            Mouse::State::LeftPressed,
+            [&editor, &input_latency] {
+                editor.increment(0.01f);
+                editor.set();
+                input_latency.edited();
+            });
+        mouse_state.add(
+            Mouse::State::LeftPressed,
+            Mouse::Action::ScrollDown,
+            Mouse::State::LeftPressed,
+            [&editor, &input_latency] {
+                editor.increment(-0.01f);
+                editor.set();
+                input_latency.edited();
+            });
+        mouse_state.add<float, float>(
+            Mouse::State::LeftPressed,
+            Mouse::Action::Movement,
+            Mouse::State::LeftPressed,
+            [&editor, &camera, &input_latency](auto xoffset, auto zoffset) {
+                editor.updateCursor(xoffset, zoffset);
+                editor.set();
+                input_latency.edited();
+            });
+        mouse_state.add<float, float>(
+            Mouse::State::Default,
+            Mouse::Action::Movement,
+            Mouse::State::Default,
+            [&editor, &camera](auto xoffset, auto zoffset) {
+                editor.updateCursor(xoffset, zoffset);
+            });
+
+        auto projection = glm::perspective(
+            glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        // auto projection = glm::ortho(-4.f, 4.f, -3.f, 3.f, 0.1f, 100.0f);
+
+        cursor_shader.use();
+        cursor_shader.set("projection", projection);
+        cursor_shader.set("view", camera.GetViewMatrix());
+
+        triangle_shader.use();
+        triangle_shader.set("projection", projection);
+        triangle_shader.set("view", camera.GetViewMatrix());
+
+        wireframe_shader.use();
+        wireframe_shader.set("projection", projection);
+        wireframe_shader.set("view", camera.GetViewMatrix());
+
+        mouseMovementCallbacks.push_back([&input_latency,
+                                          firstMouse = true,
+                                          lastX      = SCR_WIDTH / 2.0f,
+                                          lastY = SCR_HEIGHT / 2.0f](auto xpos, auto ypos) mutable {
+            input_latency.event();
+            if (firstMouse) {
+                lastX      = xpos;
+                lastY      = ypos;
+                firstMouse = false;
+            }
+
+            float xoffset = xpos - lastX;
+            float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+
+            lastX = xpos;
+            lastY = ypos;
+
+            mouse_state.execute(Mouse::Action::Movement, xoffset, yoffset);
+        });
+
+        mouseButtonCallbacks.push_back([](auto button, auto action, auto) {
+            static std::map<int, std::map<int, Mouse::Action>> config{
+                {GLFW_MOUSE_BUTTON_LEFT,
+                 {{GLFW_PRESS, Mouse::Action::LeftPress},
+                  {GLFW_RELEASE, Mouse::Action::LeftRelease}}},
+                {GLFW_MOUSE_BUTTON_RIGHT,
+                 {{GLFW_PRESS, Mouse::Action::RightPress},
+                  {GLFW_RELEASE, Mouse::Action::RightRelease}}}};
+            mouse_state.execute(config[button][action]);
+        });
+        mouseScrollCallbacks.push_back([&input_latency](auto xoffset, auto yoffset) {
+            input_latency.event();
+            if (yoffset > 0.0f)
+                mouse_state.execute(Mouse::Action::ScrollUp);
+            else if (yoffset < 0.0f)
+                mouse_state.execute(Mouse::Action::ScrollDown);
+        });
+
+        keyCallbacks.push_back([&editor](auto key, auto action, auto mods) {
+            if (action != GLFW_PRESS || mods & GLFW_MOD_CONTROL)
+                return;
+            // 1, 2 and 3 toggle the sculpt, stamp and erosion layers.
+            if (key >= GLFW_KEY_1 && key < GLFW_KEY_1 + int(LayerStack::Count))
+                editor.toggleLayer(size_t(key - GLFW_KEY_1));
         });
-    mouse_state.add(
-        Mouse::State::LeftPressed, Mouse::Action::ScrollUp, Mouse::State::LeftPressed, [&editor] {
-            editor.increment(0.01f);
-            editor.set();
+        // F3 shows the performance overlay.
+        keyCallbacks.push_back([&hud](auto key, auto action, auto) {
+            if (key == GLFW_KEY_F3 && action == GLFW_PRESS)
+                hud.toggle();
         });
-    mouse_state.add(
-        Mouse::State::LeftPressed, Mouse::Action::ScrollDown, Mouse::State::LeftPressed, [&editor] {
-            editor.increment(-0.01f);
-            editor.set();
+#ifdef PROFILER
+        // F9 saves the profile recorded so far.
+        keyCallbacks.push_back([](auto key, auto action, auto) {
+            if (key == GLFW_KEY_F9 && action == GLFW_PRESS && WriteChromeTrace("profile.json"))
+                std::cout << "Profile written to profile.json" << std::endl;
         });
-    mouse_state.add<float, float>(
-        Mouse::State::LeftPressed,
-        Mouse::Action::Movement,
-        Mouse::State::LeftPressed,
-        [&editor, &camera](auto xoffset, auto zoffset) {
-            editor.updateCursor(xoffset, zoffset);
-            editor.set();
+#endif
+        keyCallbacks.push_back([&editor](auto key, auto action, auto mods) {
+            if (action == GLFW_RELEASE || !(mods & GLFW_MOD_CONTROL))
+                return;
+            if (key == GLFW_KEY_Z && !(mods & GLFW_MOD_SHIFT))
+                editor.undo();
+            else if (key == GLFW_KEY_Y || key == GLFW_KEY_Z)
+                editor.redo();
         });
-    mouse_state.add<float, float>(
-        Mouse::State::Default,
-        Mouse::Action::Movement,
-        Mouse::State::Default,
-        [&editor, &camera](auto xoffset, auto zoffset) { editor.updateCursor(xoffset, zoffset); });
-
-    auto projection = glm::perspective(
-        glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    // auto projection = glm::ortho(-4.f, 4.f, -3.f, 3.f, 0.1f, 100.0f);
-
-    cursor_shader.use();
-    cursor_shader.set("projection", projection);
-    cursor_shader.set("view", camera.GetViewMatrix());
-
-    triangle_shader.use();
-    triangle_shader.set("projection", projection);
-    triangle_shader.set("view", camera.GetViewMatrix());
-
-    wireframe_shader.use();
-    wireframe_shader.set("projection", projection);
-    wireframe_shader.set("view", camera.GetViewMatrix());
-
-    mouseMovementCallbacks.push_back([firstMouse = true,
-                                      lastX      = SCR_WIDTH / 2.0f,
-                                      lastY = SCR_HEIGHT / 2.0f](auto xpos, auto ypos) mutable {
-        if (firstMouse) {
-            lastX      = xpos;
-            lastY      = ypos;
-            firstMouse = false;
+
+        // Frames in which the main thread allocated; painting and camera movement only allocate
+        // while tiles stream in or the journal checkpoints.
+        auto frames            = uint64_t{};
+        auto allocating_frames = uint64_t{};
+        auto max_allocations   = uint64_t{};
+        auto allocations       = ThreadAllocations().allocations;
+        const auto start       = glfwGetTime();
+        startup.mark("Setup");
+
+        // render loop
+        // -----------
+        while (!glfwWindowShouldClose(window)) {
+            PROFILE_ZONE("Frame");
+            // per-frame time logic
+            // --------------------
+            auto currentFrame = glfwGetTime();
+            deltaTime         = currentFrame - lastFrame;
+            lastFrame         = currentFrame;
+            // The editor sees the recorded time steps, so time-driven work repeats too.
+            if (replay) {
+                const auto step = replay->nextFrame(!fast);
+                if (!step)
+                    break;
+                deltaTime = *step;
+            }
+            if (recorder)
+                recorder->frame(deltaTime);
+
+            processInput(window);
+            input_latency.collect();
+            editor.update(camera, deltaTime);
+            if (editor.hasLoadFailed()) {
+                result = -1;
+                break;
+            }
+            // render
+            // ------
+            glClearColor(0.0f, 0.0f, 0.5f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            editor.draw(triangle_shader, wireframe_shader, cursor_shader);
+            hud.addFrame(deltaTime, editor);
+            // Both read statistics of the map, which would wait for it to load.
+            if (metrics_exporter && editor.isLoaded())
+                editor_metrics.sample(editor, deltaTime);
+            if (hud.isVisible() && editor.isLoaded()) {
+                int width, height;
+                glfwGetFramebufferSize(window, &width, &height);
+                hud.draw(hud_shader, width, height, editor);
+            }
+
+            // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+            // -------------------------------------------------------------------------------
+            input_latency.submitted();
+            {
+                PROFILE_ZONE("Swap");
+                glfwSwapBuffers(window);
+            }
+            input_latency.swapped();
+            if (!startup.isReported() && editor.isLoaded()) {
+                startup.mark("Map");
+                startup.report();
+            }
+            {
+                PROFILE_ZONE("Input");
+                glfwPollEvents();
+                if (replay) {
+                    for (auto& event : replay->getFrameEvents())
+                        dispatch(window, event);
+                }
+            }
+
+            const auto total = ThreadAllocations().allocations;
+            frames++;
+            allocating_frames += total > allocations;
+            max_allocations = std::max(max_allocations, total - allocations);
+            allocations     = total;
+#ifdef GL_CALL_COUNTER
+            EndGLCallFrame();
+#endif
         }
 
-        float xoffset = xpos - lastX;
-        float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
-
-        lastX = xpos;
-        lastY = ypos;
-
-        mouse_state.execute(Mouse::Action::Movement, xoffset, yoffset);
-    });
-
-    mouseButtonCallbacks.push_back([](auto button, auto action, auto) {
-        static std::map<int, std::map<int, Mouse::Action>> config{
-            {GLFW_MOUSE_BUTTON_LEFT,
-             {{GLFW_PRESS, Mouse::Action::LeftPress}, {GLFW_RELEASE, Mouse::Action::LeftRelease}}},
-            {GLFW_MOUSE_BUTTON_RIGHT,
-             {{GLFW_PRESS, Mouse::Action::RightPress},
-              {GLFW_RELEASE, Mouse::Action::RightRelease}}}};
-        mouse_state.execute(config[button][action]);
-    });
-    mouseScrollCallbacks.push_back([](auto xoffset, auto yoffset) {
-        if (yoffset > 0.0f)
-            mouse_state.execute(Mouse::Action::ScrollUp);
-        else if (yoffset < 0.0f)
-            mouse_state.execute(Mouse::Action::ScrollDown);
-    });
-
-    // render loop
-    // -----------
-    while (!glfwWindowShouldClose(window)) {
-        // per-frame time logic
-        // --------------------
-        auto currentFrame = glfwGetTime();
-        deltaTime         = currentFrame - lastFrame;
-        lastFrame         = currentFrame;
-
-        processInput(window);
-        // render
-        // ------
-        glClearColor(0.0f, 0.0f, 0.5f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        editor.draw(triangle_shader, wireframe_shader, cursor_shader);
-
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        auto stats = editor.getCacheStats();
+        std::cout << "Tile cache: " << stats.resident_tiles << " resident tiles ("
+                  << (stats.resident_bytes >> 20) << " MiB of " << (stats.budget_bytes >> 20)
+                  << " MiB), hit rate " << stats.hitRate() * 100.0 << "%, " << stats.loads
+                  << " async loads, " << stats.evictions << " evictions, " << stats.shared_reads
+                  << " shared reads" << std::endl;
+        std::cout << "Tile compression: " << stats.compressed_tiles << " tiles ("
+                  << (stats.compressed_bytes >> 20) << " MiB) compressed, ratio "
+                  << stats.compressionRatio() << ", " << stats.compressions << " compressions at "
+                  << stats.compressRate() << " MiB/s, " << stats.decompressions
+                  << " decompressions at " << stats.decompressRate() << " MiB/s" << std::endl;
+        auto prefetch = editor.getPrefetchStats();
+        std::cout << "Prefetch: " << prefetch.issued << " issued, accuracy "
+                  << prefetch.accuracy() * 100.0 << "% (" << prefetch.used << " used, "
+                  << prefetch.unused << " unused, " << prefetch.cancelled << " cancelled), "
+                  << prefetch.stall_frames << " of " << prefetch.frames << " frames stalled"
+                  << std::endl;
+        auto history = editor.getHistoryStats();
+        std::cout << "History: " << history.position << " of " << history.strokes
+                  << " strokes applied, " << (history.memory_bytes >> 10) << " KiB in memory, "
+                  << history.spilled_strokes << " strokes (" << (history.spilled_bytes >> 10)
+                  << " KiB) spilled" << std::endl;
+        auto layers = editor.getLayerStats();
+        std::cout << "Layers: " << layers.layer_tiles << " layer tiles, " << layers.composite_tiles
+                  << " composited tiles (" << layers.composite_evictions << " dropped), "
+                  << layers.composited_samples << " samples blended" << std::endl;
+        auto journal = editor.getJournalStats();
+        std::cout << "Journal: " << journal.replayed_records << " records replayed, "
+                  << journal.checkpoints << " checkpoints, " << journal.tiles_written
+                  << " tiles written, " << journal.compactions << " compactions, "
+                  << (journal.bytes >> 10) << " KiB" << std::endl;
+        auto buffers = editor.getBufferStats();
+        std::cout << "GPU buffers: " << buffers.ranges << " ranges, "
+                  << (buffers.used_bytes >> 10) << " KiB used of "
+                  << (buffers.capacity_bytes >> 10) << " KiB in " << buffers.blocks
+                  << " blocks, largest free range " << (buffers.largest_free_bytes >> 10) << " KiB"
+                  << std::endl;
+        auto memory = editor.getMemoryStats();
+        std::cout << "CPU memory: heights " << (memory.heights >> 10) << " KiB, layers "
+                  << (memory.layers >> 20) << " MiB, history " << (memory.history >> 20)
+                  << " MiB, tile cache " << (memory.tile_cache >> 20) << " MiB, frame arena "
+                  << (memory.frame_arena >> 10) << " KiB; " << (HeapBytes() >> 20)
+                  << " MiB live on the heap" << std::endl;
+        const auto objects = GetGLObjectCounts();
+        // GPU bytes are what the editor asked for, e.g. RG32F texels for the quantisation texture;
+        // the driver's padding, alignment and shadow copies are not queried.
+        std::cout << "GPU memory (estimated): buffer pool " << (memory.buffer_pool >> 20)
+                  << " MiB (mesh "
+                  << (memory.mesh_buffers >> 10) << " KiB), mesh texture "
+                  << (memory.mesh_texture >> 10) << " KiB, upload ring "
+                  << (memory.upload_ring >> 20) << " MiB; " << objects.buffers << " buffers, "
+                  << objects.vertex_arrays << " vertex arrays, " << objects.textures
+                  << " textures, " << objects.queries << " queries live" << std::endl;
+        auto uploads = editor.getUploadStats();
+        std::cout << "Uploads: " << (uploads.uploaded_bytes >> 20) << " MiB through the "
+                  << (uploads.persistent ? "persistent" : "mapped") << " ring in " << uploads.frames
+                  << " frames, " << uploads.overflows << " overflows, " << uploads.fence_waits
+                  << " fence waits (" << uploads.wait_seconds * 1000.0 << " ms)" << std::endl;
+        auto& gpu_timer = editor.getGpuTimer();
+        std::cout << "GPU passes:";
+        for (auto& pass : gpu_timer.getPasses())
+            std::cout << " " << pass.name << " " << pass.average_ms << " ms";
+        std::cout << (gpu_timer.isSupported() ? "" : " unsupported") << ", "
+                  << gpu_timer.getSkippedFrames() << " frames skipped" << std::endl;
+        const auto milliseconds = [](const Histogram& histogram, double quantile) {
+            return histogram.getQuantile(quantile) / 1e6;
+        };
+        std::cout << "Input latency: " << input_latency.getTotal().getCount()
+                  << " edited frames, p50 " << milliseconds(input_latency.getTotal(), 0.5)
+                  << " ms, p99 " << milliseconds(input_latency.getTotal(), 0.99) << " ms, max "
+                  << input_latency.getTotal().getMax() / 1e6 << " ms; p50 edit "
+                  << milliseconds(input_latency.getEdit(), 0.5) << " ms, queue "
+                  << milliseconds(input_latency.getQueue(), 0.5) << " ms, present "
+                  << milliseconds(input_latency.getPresent(), 0.5) << " ms; "
+                  << input_latency.getDroppedFrames() << " frames dropped" << std::endl;
+        const auto gl_state = GetGLStateStats();
+        std::cout << "GL state: " << gl_state.elided << " of " << gl_state.calls
+                  << " state changes elided" << std::endl;
+#ifdef GL_CALL_COUNTER
+        const auto gl_frames = std::max<uint64_t>(GetGLCallFrames(), 1);
+        std::cout << "GL calls per frame:";
+        for (auto& entry : GetGLCallStats()) {
+            std::cout << " " << entry.name << " " << double(entry.calls) / gl_frames << " (max "
+                      << entry.max_frame_calls << ")";
+        }
+        std::cout << std::endl;
+#endif
+        std::cout << "Frame allocations: " << allocating_frames << " of " << frames
+                  << " frames allocated, at most " << max_allocations << " per frame" << std::endl;
+
+        // Without a map there are no heights to hash; an unfinished log has no final hash.
+        if (recorder && recorder->isOpen() && editor.waitUntilLoaded()) {
+            const auto hash = editor.getHeightHash();
+            recorder->finish(hash);
+            std::cout << "Input log: " << recorder->getEvents() << " events in "
+                      << recorder->getFrames() << " frames, " << (recorder->getBytes() >> 10)
+                      << " KiB written to " << record_path.string() << ", height hash " << std::hex
+                      << hash << std::dec << std::endl;
+        }
+        if (replay && editor.waitUntilLoaded()) {
+            const auto hash     = editor.getHeightHash();
+            const auto expected = replay->getHeightHash();
+            std::cout << "Replay: " << frames << " of " << replay->getFrames() << " frames, "
+                      << replay->getEvents() << " events in " << glfwGetTime() - start << " s, "
+                      << (glfwGetTime() - start) * 1000.0 / std::max<uint64_t>(frames, 1)
+                      << " ms per frame, height hash " << std::hex << hash << std::dec
+                      << (!expected ? " (not recorded)" : hash == *expected ? " matches" : "")
+                      << std::endl;
+            if (expected && hash != *expected) {
+                std::cout << "ERROR::INPUT_LOG::HEIGHT_MISMATCH expected " << std::hex << *expected
+                          << std::dec << std::endl;
+                result = 1;
+            }
+        }
+
+        // The callbacks capture the objects above.
+        mouseMovementCallbacks.clear();
+        mouseScrollCallbacks.clear();
+        mouseButtonCallbacks.clear();
+        keyCallbacks.clear();
     }
 
+#ifdef PROFILER
+    WriteChromeTrace("profile.json");
+#endif
+
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
-    return 0;
+    return result;
 }
 
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react
@@ -233,3 +581,28 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     for (auto& callback : mouseScrollCallbacks)
         callback(xoffset, yoffset);
 }
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    for (auto& callback : keyCallbacks)
+        callback(key, action, mods);
+}
+
+// Hands a replayed event to the callback GLFW would have called.
+void dispatch(GLFWwindow* window, const InputEvent& event) {
+    switch (event.type) {
+    case InputEvent::Type::Cursor:
+        mouse_callback(window, event.x, event.y);
+        break;
+    case InputEvent::Type::Button:
+        mouse_button_callback(window, event.code, event.action, event.mods);
+        break;
+    case InputEvent::Type::Scroll:
+        scroll_callback(window, event.x, event.y);
+        break;
+    case InputEvent::Type::Key:
+        key_callback(window, event.code, 0, event.action, event.mods);
+        break;
+    default:
+        break;
+    }
+}
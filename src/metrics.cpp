@@ -0,0 +1,179 @@
+#include "metrics.hpp"
+
+#include <bit>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+constexpr uint64_t Exact = uint64_t{1} << Histogram::SignificantBits;
+constexpr uint64_t Half  = Exact / 2;
+// Quantiles written for each histogram.
+constexpr double Quantiles[] = {0.5, 0.9, 0.99, 0.999};
+// Enough for byte counts and nanoseconds in seconds.
+constexpr int Precision = 15;
+
+size_t bucketOf(uint64_t value) {
+    if (value < Exact)
+        return size_t(value);
+    const auto shift = uint32_t(std::bit_width(value)) - Histogram::SignificantBits;
+    return size_t(Exact + (shift - 1) * Half + (value >> shift) - Half);
+}
+
+// The middle of a bucket.
+uint64_t valueOf(size_t bucket) {
+    if (bucket < Exact)
+        return bucket;
+    const auto shift = uint32_t((bucket - Exact) / Half + 1);
+    const auto lower = ((bucket - Exact) % Half + Half) << shift;
+    return lower + (uint64_t{1} << shift) / 2;
+}
+
+template <typename T>
+T& find(std::deque<T>& metrics, const std::string& name, const std::string& help) {
+    for (auto& metric : metrics) {
+        if (metric.getName() == name)
+            return metric;
+    }
+    return metrics.emplace_back(name, help);
+}
+
+double unixTime() {
+    return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+} // namespace
+
+void Histogram::record(uint64_t nanoseconds) {
+    buckets_[bucketOf(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+    auto max = max_.load(std::memory_order_relaxed);
+    while (nanoseconds > max && !max_.compare_exchange_weak(max, nanoseconds))
+        ;
+}
+
+uint64_t Histogram::getQuantile(double quantile) const {
+    const auto count = getCount();
+    if (count == 0)
+        return 0;
+    // Recording may go on meanwhile, so the buckets can hold a few more than `count`.
+    const auto rank = std::max<uint64_t>(1, uint64_t(std::ceil(quantile * count)));
+    auto seen       = uint64_t{};
+    for (auto bucket = size_t{}; bucket < Buckets; bucket++) {
+        seen += buckets_[bucket].load(std::memory_order_relaxed);
+        if (seen >= rank)
+            return std::min(valueOf(bucket), getMax());
+    }
+    return getMax();
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help) {
+    std::lock_guard lock{mutex_};
+    return find(counters_, name, help);
+}
+
+Gauge& MetricsRegistry::gauge(const std::string& name, const std::string& help) {
+    std::lock_guard lock{mutex_};
+    return find(gauges_, name, help);
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help) {
+    std::lock_guard lock{mutex_};
+    return find(histograms_, name, help);
+}
+
+void MetricsRegistry::writePrometheus(std::ostream& out) const {
+    std::lock_guard lock{mutex_};
+    out << std::setprecision(Precision);
+    for (auto& counter : counters_) {
+        out << "# HELP " << counter.getName() << " " << counter.getHelp() << "\n"
+            << "# TYPE " << counter.getName() << " counter\n"
+            << counter.getName() << " " << counter.get() << "\n";
+    }
+    for (auto& gauge : gauges_) {
+        out << "# HELP " << gauge.getName() << " " << gauge.getHelp() << "\n"
+            << "# TYPE " << gauge.getName() << " gauge\n"
+            << gauge.getName() << " " << gauge.get() << "\n";
+    }
+    for (auto& histogram : histograms_) {
+        const auto& name = histogram.getName();
+        out << "# HELP " << name << " " << histogram.getHelp() << "\n"
+            << "# TYPE " << name << " summary\n";
+        for (auto quantile : Quantiles) {
+            out << name << "{quantile=\"" << quantile << "\"} "
+                << histogram.getQuantile(quantile) / 1e9 << "\n";
+        }
+        out << name << "_sum " << histogram.getSum() / 1e9 << "\n"
+            << name << "_count " << histogram.getCount() << "\n";
+    }
+}
+
+void MetricsRegistry::writeJsonLine(std::ostream& out) const {
+    std::lock_guard lock{mutex_};
+    out << std::setprecision(Precision) << "{\"time\":" << unixTime();
+    for (auto& counter : counters_)
+        out << ",\"" << counter.getName() << "\":" << counter.get();
+    for (auto& gauge : gauges_)
+        out << ",\"" << gauge.getName() << "\":" << gauge.get();
+    for (auto& histogram : histograms_) {
+        out << ",\"" << histogram.getName() << "\":{\"count\":" << histogram.getCount()
+            << ",\"sum\":" << histogram.getSum() / 1e9;
+        for (auto quantile : Quantiles)
+            out << ",\"p" << quantile * 100 << "\":" << histogram.getQuantile(quantile) / 1e9;
+        out << ",\"max\":" << histogram.getMax() / 1e9 << "}";
+    }
+    out << "}\n";
+}
+
+MetricsRegistry& GlobalMetrics() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+MetricsExporter::MetricsExporter(
+    MetricsRegistry& registry, std::filesystem::path path, std::chrono::seconds interval)
+  : registry_{registry}, path_{std::move(path)}, interval_{interval},
+    prometheus_{path_.extension() == ".prom"}, worker_{[this] { run(); }} {}
+
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard lock{mutex_};
+        stop_ = true;
+    }
+    condition_.notify_one();
+    worker_.join();
+    write();
+}
+
+void MetricsExporter::run() {
+    std::unique_lock lock{mutex_};
+    while (!condition_.wait_for(lock, interval_, [this] { return stop_; }))
+        write();
+}
+
+void MetricsExporter::write() {
+    if (!prometheus_) {
+        std::ofstream out{path_, std::ios::app};
+        registry_.writeJsonLine(out);
+        if (!out)
+            std::cout << "ERROR::METRICS::WRITE_FAILED" << std::endl;
+        return;
+    }
+    // Scrapers must never see a partly written file.
+    auto temporary = path_;
+    temporary += ".tmp";
+    {
+        std::ofstream out{temporary, std::ios::trunc};
+        registry_.writePrometheus(out);
+        if (!out) {
+            std::cout << "ERROR::METRICS::WRITE_FAILED" << std::endl;
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path_, error);
+    if (error)
+        std::cout << "ERROR::METRICS::WRITE_FAILED" << std::endl;
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+
+// Counters, gauges and latency histograms for long-running sessions, written periodically to a
+// file in Prometheus text format or as JSON lines.
+//
+// Metrics are registered once by name and live as long as the registry; updating one is a relaxed
+// atomic operation, safe from any thread, that neither locks nor allocates.
+class Counter {
+  public:
+    Counter(std::string name, std::string help) : name_{std::move(name)}, help_{std::move(help)} {}
+
+    void add(uint64_t count = 1) { value_.fetch_add(count, std::memory_order_relaxed); }
+    // For totals a subsystem already keeps.
+    void set(uint64_t total) { value_.store(total, std::memory_order_relaxed); }
+    uint64_t get() const { return value_.load(std::memory_order_relaxed); }
+
+    const std::string& getName() const { return name_; }
+    const std::string& getHelp() const { return help_; }
+
+  private:
+    std::string name_;
+    std::string help_;
+    std::atomic<uint64_t> value_ = 0;
+};
+
+class Gauge {
+  public:
+    Gauge(std::string name, std::string help) : name_{std::move(name)}, help_{std::move(help)} {}
+
+    void set(double value) { value_.store(value, std::memory_order_relaxed); }
+    double get() const { return value_.load(std::memory_order_relaxed); }
+
+    const std::string& getName() const { return name_; }
+    const std::string& getHelp() const { return help_; }
+
+  private:
+    std::string name_;
+    std::string help_;
+    std::atomic<double> value_ = 0.0;
+};
+
+// Durations in nanoseconds, in log-linear buckets like HdrHistogram: each power of two splits into
+// 2^(SignificantBits - 1) buckets, so a quantile is within 1 / 2^(SignificantBits - 1) of the
+// recorded value over the whole range up to centuries.
+class Histogram {
+  public:
+    static constexpr uint32_t SignificantBits = 6;
+    static constexpr size_t Buckets           = (66 - SignificantBits) << (SignificantBits - 1);
+
+    Histogram(std::string name, std::string help)
+      : name_{std::move(name)}, help_{std::move(help)} {}
+
+    void record(uint64_t nanoseconds);
+    void record(std::chrono::nanoseconds duration) { record(uint64_t(duration.count())); }
+    void recordSeconds(double seconds) { record(uint64_t(std::max(seconds, 0.0) * 1e9)); }
+
+    uint64_t getCount() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t getSum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t getMax() const { return max_.load(std::memory_order_relaxed); }
+    // The value below which `quantile` of the recordings fall, in nanoseconds; 0 while empty.
+    uint64_t getQuantile(double quantile) const;
+
+    const std::string& getName() const { return name_; }
+    const std::string& getHelp() const { return help_; }
+
+  private:
+    std::string name_;
+    std::string help_;
+    std::array<std::atomic<uint64_t>, Buckets> buckets_{};
+    std::atomic<uint64_t> count_ = 0;
+    std::atomic<uint64_t> sum_   = 0;
+    std::atomic<uint64_t> max_   = 0;
+};
+
+class MetricsRegistry {
+  public:
+    // Registering a name again returns the metric registered first.
+    Counter& counter(const std::string& name, const std::string& help);
+    Gauge& gauge(const std::string& name, const std::string& help);
+    Histogram& histogram(const std::string& name, const std::string& help);
+
+    // Histograms are written as summaries, with quantiles in seconds.
+    void writePrometheus(std::ostream& out) const;
+    // One JSON object holding every metric and the Unix time in seconds.
+    void writeJsonLine(std::ostream& out) const;
+
+  private:
+    mutable std::mutex mutex_;
+    std::deque<Counter> counters_;
+    std::deque<Gauge> gauges_;
+    std::deque<Histogram> histograms_;
+};
+
+// The registry the editor's subsystems report to.
+MetricsRegistry& GlobalMetrics();
+
+// Writes a registry to `path` every `interval` on a worker thread, and once more when destroyed.
+// A ".prom" file is replaced each time, for node_exporter's textfile collector; any other file
+// has a JSON line appended.
+class MetricsExporter {
+  public:
+    static constexpr std::chrono::seconds DefaultInterval{10};
+
+    MetricsExporter(
+        MetricsRegistry& registry,
+        std::filesystem::path path,
+        std::chrono::seconds interval = DefaultInterval);
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&)            = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+  private:
+    void run();
+    void write();
+
+    MetricsRegistry& registry_;
+    std::filesystem::path path_;
+    std::chrono::seconds interval_;
+    bool prometheus_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stop_ = false;
+    std::thread worker_;
+};
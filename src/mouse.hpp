@@ -4,6 +4,7 @@
 #include <functional>
 #include <iostream>
 #include <map>
+#include <type_traits>
 
 #include <GLFW/glfw3.h>
 
@@ -28,8 +29,13 @@ class StateMachine {
         config[start][action] = {end, callback};
     }
 
+    // Args are given explicitly, so lambdas convert to the callback.
     template <typename... Args>
-    void add(State start, Action action, State end, std::function<void(Args...)> callback) {
+    void add(
+        State start,
+        Action action,
+        State end,
+        std::type_identity_t<std::function<void(Args...)>> callback) {
         config[start][action] = {end, callback};
     }
 
@@ -37,11 +43,11 @@ class StateMachine {
     template <typename... Args>
     void execute(Action action, Args... args) {
         if (auto found = config.find(state); found != std::cend(config)) {
-            auto actions = std::get<1>(*found);
+            auto& actions = std::get<1>(*found);
             if (auto found = actions.find(action); found != std::end(actions)) {
-                auto [end, fn] = std::get<1>(*found);
-                state          = end;
-                std::any_cast<std::function<void(Args...)>>(fn)(args...);
+                const auto& [end, fn] = std::get<1>(*found);
+                state                 = end;
+                std::any_cast<const std::function<void(Args...)>&>(fn)(args...);
             }
         }
     }
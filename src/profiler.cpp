@@ -0,0 +1,163 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+struct ProfileEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// Only its thread or track writes to a ring; the lock is uncontended unless a trace is being
+// written.
+struct ProfileRing {
+    std::mutex mutex;
+    uint32_t thread;
+    const char* name = nullptr;
+    std::vector<ProfileEvent> events;
+    uint64_t count = 0;
+
+    void record(const char* zone, uint64_t start, uint64_t end) {
+        std::lock_guard lock{mutex};
+        events[count++ % ProfileZone::MaxEvents] = {zone, start, end};
+    }
+};
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+const auto epoch = Clock::now();
+
+std::mutex rings_mutex;
+// Rings outlive their threads, so a trace written at exit still has the workers' events. A thread
+// that exits hands its ring to the next thread that records, which appends to the same track;
+// short-lived workers thus cost no more rings than the most threads alive at once.
+std::vector<std::shared_ptr<ProfileRing>> rings;
+std::vector<std::shared_ptr<ProfileRing>> idle_rings;
+
+std::shared_ptr<ProfileRing> createRing(const char* name) {
+    auto ring  = std::make_shared<ProfileRing>();
+    ring->name = name;
+    ring->events.resize(ProfileZone::MaxEvents);
+    std::lock_guard lock{rings_mutex};
+    ring->thread = uint32_t(std::size(rings)) + 1;
+    rings.push_back(ring);
+    return ring;
+}
+
+std::shared_ptr<ProfileRing> acquireThreadRing() {
+    {
+        std::lock_guard lock{rings_mutex};
+        if (!idle_rings.empty()) {
+            auto ring = std::move(idle_rings.back());
+            idle_rings.pop_back();
+            return ring;
+        }
+    }
+    return createRing(nullptr);
+}
+
+struct ThreadRing {
+    std::shared_ptr<ProfileRing> ring = acquireThreadRing();
+
+    ~ThreadRing() {
+        std::lock_guard lock{rings_mutex};
+        idle_rings.push_back(std::move(ring));
+    }
+};
+
+ProfileRing& localRing() {
+    thread_local ThreadRing local;
+    return *local.ring;
+}
+
+void writeMicroseconds(std::ostream& out, uint64_t nanoseconds) {
+    out << nanoseconds / 1000 << '.' << std::setw(3) << std::setfill('0') << nanoseconds % 1000;
+}
+
+void writeString(std::ostream& out, const char* text) {
+    out << '"';
+    for (; *text; text++) {
+        if (*text == '"' || *text == '\\')
+            out << '\\';
+        out << *text;
+    }
+    out << '"';
+}
+} // namespace
+
+uint64_t ProfileClock() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - epoch).count();
+}
+
+ProfileZone::ProfileZone(const char* name) : name_{name}, start_{ProfileClock()} {}
+
+ProfileZone::~ProfileZone() {
+    const auto end = ProfileClock();
+    localRing().record(name_, start_, end);
+}
+
+ProfileTrack::ProfileTrack(const char* name) : ring_{createRing(name)} {}
+
+void ProfileTrack::record(const char* name, uint64_t start, uint64_t end) {
+    ring_->record(name, start, end);
+}
+
+void NameProfilerThread(const char* name) {
+    auto& ring = localRing();
+    std::lock_guard lock{ring.mutex};
+    ring.name = name;
+}
+
+bool WriteChromeTrace(const std::filesystem::path& path) {
+    std::ofstream out{path};
+    if (!out) {
+        std::cout << "ERROR::PROFILER::OPEN_FAILED " << path.string() << std::endl;
+        return false;
+    }
+    // Timestamps are in microseconds.
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    auto first    = true;
+    auto separate = [&] {
+        if (!first)
+            out << ",\n";
+        first = false;
+    };
+    std::vector<ProfileEvent> events;
+    std::lock_guard lock{rings_mutex};
+    for (auto& ring : rings) {
+        {
+            std::lock_guard lock{ring->mutex};
+            const auto count = std::min<uint64_t>(ring->count, ProfileZone::MaxEvents);
+            events.clear();
+            for (auto i = ring->count - count; i < ring->count; i++)
+                events.push_back(ring->events[i % ProfileZone::MaxEvents]);
+            if (ring->name) {
+                separate();
+                out << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << ring->thread
+                    << ",\"args\":{\"name\":";
+                writeString(out, ring->name);
+                out << "}}";
+            }
+        }
+        for (auto& event : events) {
+            separate();
+            out << "{\"ph\":\"X\",\"name\":";
+            writeString(out, event.name);
+            out << ",\"pid\":1,\"tid\":" << ring->thread << ",\"ts\":";
+            writeMicroseconds(out, event.start);
+            out << ",\"dur\":";
+            writeMicroseconds(out, event.end - event.start);
+            out << '}';
+        }
+    }
+    out << "]}" << std::endl;
+    return bool(out);
+}
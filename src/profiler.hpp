@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+
+// Scoped timing zones written to Chrome trace JSON, which chrome://tracing and Perfetto show as
+// flame graphs.
+//
+// Each thread records the start and end of its zones, in nanoseconds, into its own ring of
+// MaxEvents events that keeps the newest ones; a thread that exits leaves its ring, and its track
+// in the trace, to the next thread that records. PROFILE_ZONE(name) times the rest of the enclosing
+// scope; `name` must outlive the program, e.g. a string literal. Without PROFILER defined the zones
+// compile to nothing.
+class ProfileZone {
+  public:
+    static constexpr size_t MaxEvents = size_t{1} << 16;
+
+    explicit ProfileZone(const char* name);
+    ~ProfileZone();
+    ProfileZone(const ProfileZone&)            = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+  private:
+    const char* name_;
+    uint64_t start_;
+};
+
+struct ProfileRing;
+
+// Nanoseconds since the program started, the time base of every event.
+uint64_t ProfileClock();
+
+// A track of its own in the trace for events timed elsewhere, e.g. on the GPU. One thread at a
+// time records into it.
+class ProfileTrack {
+  public:
+    explicit ProfileTrack(const char* name);
+
+    void record(const char* name, uint64_t start, uint64_t end);
+
+  private:
+    std::shared_ptr<ProfileRing> ring_;
+};
+
+// Labels the calling thread's track in the trace.
+void NameProfilerThread(const char* name);
+// Writes the events every thread has recorded so far.
+bool WriteChromeTrace(const std::filesystem::path& path);
+
+#ifdef PROFILER
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profile_zone_, __LINE__){name}
+#define PROFILE_THREAD(name) NameProfilerThread(name)
+#else
+#define PROFILE_ZONE(name)
+#define PROFILE_THREAD(name)
+#endif
@@ -0,0 +1,59 @@
+#include "quantization.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QUANTIZATION_SSE2
+#endif
+
+void Quantize(const float* in, size_t count, Quantization quantization, uint16_t* out) {
+    const auto offset = quantization.offset;
+    const auto scale  = quantization.scale > 0.0f ? 1.0f / quantization.scale : 0.0f;
+    auto i            = size_t{};
+#ifdef QUANTIZATION_SSE2
+    // SSE2 has no unsigned 32 to 16-bit pack, so codes are biased into the signed range and back.
+    const auto o    = _mm_set1_ps(offset);
+    const auto s    = _mm_set1_ps(scale);
+    const auto max  = _mm_set1_ps(Quantization::MaxCode);
+    const auto bias = _mm_set1_epi32(32768);
+    const auto sign = _mm_set1_epi16(short(0x8000));
+    for (; i + 8 <= count; i += 8) {
+        __m128i codes[2];
+        for (auto half = 0; half < 2; half++) {
+            const auto value = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(in + i + 4 * half), o), s);
+            // max_ps returns its second operand for NaN.
+            const auto clamped = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), max);
+            codes[half]        = _mm_sub_epi32(_mm_cvtps_epi32(clamped), bias);
+        }
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(out + i),
+            _mm_xor_si128(_mm_packs_epi32(codes[0], codes[1]), sign));
+    }
+#endif
+    for (; i < count; i++) {
+        // Rounds to nearest even like the SIMD path.
+        const auto value = (in[i] - offset) * scale;
+        const auto code  = value > 0.0f ? std::min(value, Quantization::MaxCode) : 0.0f;
+        out[i]           = uint16_t(std::nearbyint(code));
+    }
+}
+
+void Dequantize(const uint16_t* in, size_t count, Quantization quantization, float* out) {
+    auto i = size_t{};
+#ifdef QUANTIZATION_SSE2
+    const auto o    = _mm_set1_ps(quantization.offset);
+    const auto s    = _mm_set1_ps(quantization.scale);
+    const auto zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        const auto codes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const auto low   = _mm_cvtepi32_ps(_mm_unpacklo_epi16(codes, zero));
+        const auto high  = _mm_cvtepi32_ps(_mm_unpackhi_epi16(codes, zero));
+        _mm_storeu_ps(out + i, _mm_add_ps(o, _mm_mul_ps(low, s)));
+        _mm_storeu_ps(out + i + 4, _mm_add_ps(o, _mm_mul_ps(high, s)));
+    }
+#endif
+    for (; i < count; i++)
+        out[i] = quantization.offset + in[i] * quantization.scale;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 16-bit height codes: a sample is stored as the code nearest to (height - offset) / scale.
+struct Quantization {
+    static constexpr float MaxCode = 65535.0f;
+
+    float offset;
+    float scale;
+
+    // Spreads the codes over [min, max]; a -10..10 range keeps steps of 0.31 mm.
+    static Quantization Fit(float min, float max) { return {min, (max - min) / MaxCode}; }
+
+    float getMax() const { return offset + scale * MaxCode; }
+    // Compared in code space: rounding can leave getMax() an ulp below the max it was fitted to.
+    bool contains(float min, float max) const {
+        if (scale == 0.0f)
+            return min == offset && max == offset;
+        return (min - offset) / scale >= -0.5f && (max - offset) / scale <= MaxCode + 0.5f;
+    }
+};
+
+// Heights outside the range saturate, NaN maps to the lowest code.
+void Quantize(const float* in, size_t count, Quantization quantization, uint16_t* out);
+void Dequantize(const uint16_t* in, size_t count, Quantization quantization, float* out);
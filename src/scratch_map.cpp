@@ -0,0 +1,42 @@
+#include "scratch_map.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "tile_file.hpp"
+
+std::filesystem::path UniqueTemporaryPath(std::string_view name, std::string_view extension) {
+    static std::atomic<uint64_t> count = 0;
+#ifdef _WIN32
+    const auto pid = _getpid();
+#else
+    const auto pid = getpid();
+#endif
+    auto file = std::string{name};
+    file += "-" + std::to_string(pid) + "-" + std::to_string(++count);
+    file += extension;
+    return std::filesystem::temp_directory_path() / file;
+}
+
+ScratchMap::ScratchMap(uint32_t width, uint32_t height)
+  : path_{UniqueTemporaryPath("scratch", ".tvhm")} {
+    remove();
+    open_ = TileFile::Create(path_, width, height, nullptr);
+    if (!open_)
+        std::cout << "ERROR::SCRATCH_MAP::CREATE_FAILED " << path_.string() << std::endl;
+}
+
+ScratchMap::~ScratchMap() { remove(); }
+
+void ScratchMap::remove() const {
+    std::error_code error;
+    std::filesystem::remove(path_, error);
+    std::filesystem::remove(std::filesystem::path{path_}.concat(".journal"), error);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+// A path in the temporary directory that no other call in any live process returns:
+// `<name>-<process id>-<count><extension>`. Files left there by a crashed process may be reused.
+std::filesystem::path UniqueTemporaryPath(std::string_view name, std::string_view extension);
+
+// A flat map of its own for one recorded, replayed or stress session, in the temporary directory
+// and named after the process, so such sessions always start flat and leave the untitled maps and
+// their crash-recovery journals alone. The map, its journal and any left over by a crashed
+// process with the same id are deleted; destroy the editor using it first.
+class ScratchMap {
+  public:
+    ScratchMap(uint32_t width, uint32_t height);
+    ScratchMap(const ScratchMap&)            = delete;
+    ScratchMap& operator=(const ScratchMap&) = delete;
+    ~ScratchMap();
+
+    bool isOpen() const { return open_; }
+    const std::filesystem::path& getPath() const { return path_; }
+
+  private:
+    void remove() const;
+
+    std::filesystem::path path_;
+    bool open_;
+};
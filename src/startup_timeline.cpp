@@ -0,0 +1,28 @@
+#include "startup_timeline.hpp"
+
+#include <iostream>
+
+void StartupTimeline::mark(const char* name) {
+    if (count_ == MaxPhases)
+        return;
+    const auto end = ProfileClock();
+#ifdef PROFILER
+    const auto start = count_ ? phases_[count_ - 1].end : 0;
+    track_.record(name, start, end);
+#endif
+    phases_[count_++] = {name, end};
+}
+
+void StartupTimeline::report() {
+    if (reported_)
+        return;
+    reported_ = true;
+    std::cout << "Startup:";
+    auto start = uint64_t{};
+    for (auto i = size_t{}; i < count_; i++) {
+        std::cout << (i ? ", " : " ") << phases_[i].name << " "
+                  << double(phases_[i].end - start) / 1e6 << " ms";
+        start = phases_[i].end;
+    }
+    std::cout << "; " << double(start) / 1e6 << " ms in total" << std::endl;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "profiler.hpp"
+
+// Phases of startup, from the program start to the first frame that shows the map. Each phase
+// ends where the next begins; the report prints their durations and, with PROFILER, they appear
+// as a "Startup" track of the trace.
+class StartupTimeline {
+  public:
+    static constexpr size_t MaxPhases = 16;
+
+    // Ends the current phase; `name` must outlive the program, e.g. a string literal.
+    void mark(const char* name);
+    // Prints the phases once.
+    void report();
+    bool isReported() const { return reported_; }
+
+  private:
+    struct Phase {
+        const char* name;
+        uint64_t end;
+    };
+
+    std::array<Phase, MaxPhases> phases_{};
+    size_t count_  = 0;
+    bool reported_ = false;
+#ifdef PROFILER
+    ProfileTrack track_{"Startup"};
+#endif
+};
@@ -0,0 +1,243 @@
+#include "stress.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include <glad/glad.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/camera.hpp>
+#include <learnopengl/shader.hpp>
+
+#include "allocation_counter.hpp"
+#include "editor.hpp"
+#include "gl_object.hpp"
+#include "metrics.hpp"
+#include "scratch_map.hpp"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr float DeltaTime = 1.0f / 60.0f;
+// Dabs of a synthetic stroke, each half a radius on from the last.
+constexpr int StrokeDabs     = 16;
+constexpr float ScrollRadius = 16.0f;
+
+enum class Workload { Strokes, FullMap, Scroll };
+
+// Peak resident set of the process in bytes, or 0 where unknown.
+size_t peakResident() {
+#ifdef _WIN32
+    return 0;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return size_t(usage.ru_maxrss);
+#else
+    return size_t(usage.ru_maxrss) << 10;
+#endif
+#endif
+}
+
+double milliseconds(const Histogram& histogram, double quantile) {
+    return histogram.getQuantile(quantile) / 1e6;
+}
+} // namespace
+
+int RunStress(int count, char* args[]) {
+    const auto workloads = std::unordered_map<std::string_view, Workload>{
+        {"strokes", Workload::Strokes},
+        {"full-map", Workload::FullMap},
+        {"scroll", Workload::Scroll},
+    };
+    const auto found = count > 0 ? workloads.find(args[0]) : workloads.end();
+    if (found == workloads.end()) {
+        std::cout << "Available workloads:";
+        for (auto& [name, workload] : workloads)
+            std::cout << " " << name;
+        std::cout << std::endl;
+        return -1;
+    }
+    const auto workload = found->second;
+
+    auto size       = 1024u;
+    auto seconds    = 10.0f;
+    auto rate       = workload == Workload::Scroll ? 20.0f : 10.0f;
+    auto max_radius = 32.0f;
+    auto seed       = 1u;
+    auto check      = false;
+    for (auto i = 1; i < count; i++) {
+        if (auto arg = std::string_view{args[i]}; arg == "--size" && i + 1 < count)
+            size = std::max(64, std::atoi(args[++i]));
+        else if (arg == "--seconds" && i + 1 < count)
+            seconds = std::max(0.1f, float(std::atof(args[++i])));
+        else if (arg == "--rate" && i + 1 < count)
+            rate = std::max(0.0f, float(std::atof(args[++i])));
+        else if (arg == "--max-radius" && i + 1 < count)
+            max_radius = std::max(1.0f, float(std::atof(args[++i])));
+        else if (arg == "--seed" && i + 1 < count)
+            seed = unsigned(std::atoi(args[++i]));
+        else if (arg == "--check-leaks")
+            check = true;
+    }
+
+    Camera camera({0.0f, 3.0f, 10.0f}, {0.0f, 1.0f, 0.0f}, -90.f, -20.0f);
+    Shader cursor_shader("shaders/cursor.vs", "shaders/cursor.fs");
+    Shader triangle_shader("shaders/triangle.vs", "shaders/default.fs");
+    Shader wireframe_shader("shaders/wireframe.vs", "shaders/default.fs", "shaders/wireframe.gs");
+    const auto projection = glm::perspective(glm::radians(camera.Zoom), 4.0f / 3.0f, 0.1f, 100.0f);
+    for (auto shader : {&cursor_shader, &triangle_shader, &wireframe_shader}) {
+        shader->use();
+        shader->set("projection", projection);
+        shader->set("view", camera.GetViewMatrix());
+    }
+
+    ScratchMap scratch{size, size};
+    if (!scratch.isOpen())
+        return -1;
+    const auto load_start = Clock::now();
+    Editor editor(scratch.getPath(), Cursor{0.03, {0.79f, 0.071f, 0.13f}, 0.5f});
+    if (!editor.waitUntilLoaded())
+        return -1;
+    // Opening the map, replaying its journal, quantising the view and creating the mesh: what
+    // stands between the first frame and the first frame showing the map.
+    const auto load_seconds = std::chrono::duration<double>(Clock::now() - load_start).count();
+    std::mt19937 random{seed};
+    std::uniform_real_distribution<float> unit{0.0f, 1.0f};
+    Histogram dab_latency{"stress_dab_seconds", "Brush applications"};
+    Histogram frame_latency{"stress_frame_seconds", "Frames, finished on the GPU"};
+
+    const auto timedSet = [&] {
+        const auto start = Clock::now();
+        editor.set();
+        dab_latency.record(Clock::now() - start);
+    };
+    const auto stroke = [&] {
+        const auto radius = 1.0f + unit(random) * (max_radius - 1.0f);
+        const auto angle  = unit(random) * 6.2831853f;
+        const auto step   = radius / 2.0f * glm::vec2{std::cos(angle), std::sin(angle)};
+        auto position     = glm::vec2{unit(random), unit(random)} * float(size);
+        editor.beginStroke();
+        editor.increment(unit(random) < 0.5f ? -0.05f : 0.05f);
+        for (auto dab = 0; dab < StrokeDabs; dab++) {
+            editor.placeCursor(position, radius);
+            timedSet();
+            position = glm::clamp(position + step, glm::vec2{0.0f}, glm::vec2{size - 1.0f});
+        }
+        editor.endStroke();
+        editor.reset();
+    };
+
+    const auto frames = int(std::ceil(seconds / DeltaTime));
+    // GL objects and GPU memory once the first quarter of the frames settled the editor in.
+    const auto steady = frames / 4;
+    auto objects      = GLObjectCounts{};
+    auto gpu_bytes    = size_t{};
+    auto strokes_due  = 0.0f;
+    auto peak_cache   = size_t{};
+    auto peak_history = size_t{};
+    auto peak_buffers = size_t{};
+    auto peak_layers  = size_t{};
+    auto peak_heap    = size_t{};
+    if (workload == Workload::Scroll)
+        editor.beginStroke();
+    const auto allocations = TotalAllocations();
+    const auto start       = Clock::now();
+    for (auto frame = 0; frame < frames; frame++) {
+        if (frame == steady) {
+            objects   = GetGLObjectCounts();
+            gpu_bytes = editor.getMemoryStats().gpu();
+        }
+        const auto frame_start = Clock::now();
+        editor.update(camera, DeltaTime);
+        switch (workload) {
+        case Workload::Strokes:
+            for (strokes_due += rate * DeltaTime; strokes_due >= 1.0f; strokes_due -= 1.0f)
+                stroke();
+            break;
+        case Workload::FullMap:
+            editor.placeCursor(glm::vec2{size / 2.0f}, size * 0.75f);
+            editor.beginStroke();
+            editor.increment(frame % 2 ? -0.01f : 0.01f);
+            timedSet();
+            editor.endStroke();
+            editor.reset();
+            break;
+        case Workload::Scroll: {
+            // The cursor circles the centre slowly while the wheel spins.
+            const auto angle = frame * DeltaTime;
+            editor.placeCursor(
+                size / 2.0f + size / 4.0f * glm::vec2{std::cos(angle), std::sin(angle)},
+                ScrollRadius);
+            for (auto i = 0; i < int(rate); i++) {
+                editor.increment(unit(random) < 0.5f ? -0.01f : 0.01f);
+                timedSet();
+            }
+            break;
+        }
+        }
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        editor.draw(triangle_shader, wireframe_shader, cursor_shader);
+        glFinish();
+        frame_latency.record(Clock::now() - frame_start);
+
+        peak_cache   = std::max(peak_cache, editor.getCacheStats().resident_bytes);
+        peak_history = std::max(peak_history, editor.getHistoryStats().memory_bytes);
+        peak_buffers = std::max(peak_buffers, editor.getBufferStats().used_bytes);
+        peak_layers  = std::max(peak_layers, editor.getLayerStats().layer_tiles);
+        peak_heap    = std::max(peak_heap, HeapBytes());
+    }
+    if (workload == Workload::Scroll)
+        editor.endStroke();
+    const auto elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    const auto heap    = TotalAllocations();
+
+    std::cout << args[0] << ": " << size << "x" << size << " map loaded in "
+              << load_seconds * 1000.0 << " ms, " << frames << " frames in "
+              << elapsed << " s (" << frames / elapsed << " frames/s), " << dab_latency.getCount()
+              << " dabs (" << dab_latency.getCount() / elapsed << " dabs/s)" << std::endl;
+    std::cout << "Dab latency: p50 " << milliseconds(dab_latency, 0.5) << " ms, p99 "
+              << milliseconds(dab_latency, 0.99) << " ms, p99.9 "
+              << milliseconds(dab_latency, 0.999) << " ms, max " << dab_latency.getMax() / 1e6
+              << " ms" << std::endl;
+    std::cout << "Frame time: p50 " << milliseconds(frame_latency, 0.5) << " ms, p99 "
+              << milliseconds(frame_latency, 0.99) << " ms, max "
+              << frame_latency.getMax() / 1e6 << " ms" << std::endl;
+    std::cout << "Memory high-water: " << (peakResident() >> 20) << " MiB resident, "
+              << (peak_heap >> 20) << " MiB live heap, tile cache " << (peak_cache >> 20)
+              << " MiB, history " << (peak_history >> 10) << " KiB, " << peak_layers
+              << " layer tiles, GPU buffers " << (peak_buffers >> 10) << " KiB; "
+              << (heap.allocations - allocations.allocations) << " heap allocations ("
+              << ((heap.bytes - allocations.bytes) >> 20) << " MiB)" << std::endl;
+
+    const auto final_objects = GetGLObjectCounts();
+    const auto final_bytes   = editor.getMemoryStats().gpu();
+    std::cout << "GL objects: " << final_objects.buffers << " buffers, "
+              << final_objects.vertex_arrays << " vertex arrays, " << final_objects.textures
+              << " textures, " << final_objects.queries << " queries; GPU memory (estimated) "
+              << (final_bytes >> 10) << " KiB" << std::endl;
+    const auto grown = final_objects.buffers > objects.buffers
+                       || final_objects.vertex_arrays > objects.vertex_arrays
+                       || final_objects.textures > objects.textures
+                       || final_objects.queries > objects.queries || final_bytes > gpu_bytes;
+    if (check && grown) {
+        std::cout << "ERROR::STRESS::GPU_LEAK " << objects.buffers << " buffers, "
+                  << objects.vertex_arrays << " vertex arrays, " << objects.textures
+                  << " textures, " << objects.queries << " queries and " << (gpu_bytes >> 10)
+                  << " KiB after " << steady << " frames" << std::endl;
+        return -1;
+    }
+    return 0;
+}
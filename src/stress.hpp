@@ -0,0 +1,15 @@
+#pragma once
+
+// Drives an Editor with the synthetic workload named by args[0] at full speed and reports the time
+// to load the map, throughput, latency percentiles and memory high-water marks; returns the exit
+// code. Needs a current GL context. Frames are simulated at 60 Hz but run back to back, each drawn
+// and finished on the GPU before the next.
+//
+//   strokes [--rate N] [--max-radius R]   N strokes per second at random places, radii and angles
+//   full-map                              a brush covering the whole map, once per frame
+//   scroll [--rate N]                     N scroll increments per frame inside one long stroke
+//
+// Every workload takes --size N (samples per side of the map), --seconds S (simulated) and
+// --seed N. With --check-leaks the run fails if GL objects or GPU memory grew after the first
+// quarter of the frames.
+int RunStress(int count, char* args[]);
@@ -0,0 +1,393 @@
+#include "tile_cache.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+#include "metrics.hpp"
+#include "profiler.hpp"
+#include "tile_codec.hpp"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+} // namespace
+
+TileCache::TileCache(TileFile& file, size_t budget_bytes, TileIO::Backend backend, bool direct)
+  : file_{file}, tile_bytes_{size_t(file.getTileSize()) * file.getTileSize() * sizeof(float)},
+    io_bytes_{
+        (file.getTileBytes() + TileIO::Alignment - 1) / TileIO::Alignment * TileIO::Alignment},
+    budget_bytes_{budget_bytes},
+    references_{
+        backend == TileIO::Backend::Mapped && !direct
+        && file.getFormat() == TileFile::Format::Float32},
+    worker_{[this, backend, direct] { run(backend, direct); }} {}
+
+TileCache::~TileCache() {
+    flush();
+    {
+        std::lock_guard lock{mutex_};
+        stop_ = true;
+    }
+    condition_.notify_all();
+    worker_.join();
+}
+
+const float* TileCache::read(uint32_t tx, uint32_t ty) {
+    const auto key = TileKey(tx, ty);
+    if (!resident_.contains(key)) {
+        if (file_.isConstant(tx, ty)) {
+            shared_reads_++;
+            return constant(file_.getConstant(tx, ty));
+        }
+        if (references_) {
+            std::unique_lock lock{mutex_};
+            written_.wait(lock, [this, key] { return !writing_.contains(key); });
+            shared_reads_++;
+            return reinterpret_cast<const float*>(file_.getData() + file_.getTileOffset(tx, ty));
+        }
+    }
+    return std::data(acquire(tx, ty).samples);
+}
+
+float* TileCache::write(uint32_t tx, uint32_t ty) {
+    auto& entry = acquire(tx, ty);
+    entry.dirty = true;
+    return std::data(entry.samples);
+}
+
+bool TileCache::isResident(uint32_t tx, uint32_t ty) const {
+    return resident_.contains(TileKey(tx, ty)) || references_ || file_.isConstant(tx, ty);
+}
+
+void TileCache::request(uint32_t tx, uint32_t ty, float priority) {
+    const auto key = TileKey(tx, ty);
+    if (isResident(tx, ty))
+        return;
+    {
+        std::lock_guard lock{mutex_};
+        if (requested_.contains(key)) {
+            if (auto found = reads_.find(key); found != std::end(reads_))
+                found->second = priority;
+            return;
+        }
+        reads_[key] = priority;
+    }
+    requested_[key] = true;
+    condition_.notify_one();
+}
+
+bool TileCache::cancel(uint32_t tx, uint32_t ty) {
+    const auto key = TileKey(tx, ty);
+    std::lock_guard lock{mutex_};
+    if (reads_.erase(key) == 0)
+        return false;
+    requested_.erase(key);
+    return true;
+}
+
+void TileCache::update() {
+    PROFILE_ZONE("TileCache::update");
+    updates_++;
+    decltype(completed_) completed;
+    {
+        std::lock_guard lock{mutex_};
+        completed.swap(completed_);
+    }
+    for (auto& [key, samples] : completed) {
+        auto valid = requested_[key];
+        requested_.erase(key);
+        if (valid && !resident_.contains(key)) {
+            insert(key, std::move(samples), true);
+            loads_++;
+        }
+    }
+
+    // Tiles accessed since the last update are never compressed, so their pointers stay valid.
+    for (auto count = size_t{}; count < MaxCompressions && !lru_.empty(); count++) {
+        auto& entry = resident_.at(lru_.back());
+        if (entry.used + ColdUpdates > updates_)
+            break;
+        compress(entry);
+    }
+    while (residentBytes() > budget_bytes_ && !(cold_.empty() && lru_.empty()))
+        evict(cold_.empty() ? lru_.back() : cold_.back());
+    if (std::size(constants_) > MaxConstants)
+        constants_.clear();
+}
+
+void TileCache::flush() {
+    for (auto& [key, entry] : resident_) {
+        if (entry.dirty) {
+            writeBack(key, entry);
+            entry.dirty = false;
+        }
+    }
+    std::unique_lock lock{mutex_};
+    written_.wait(lock, [this] { return writing_.empty(); });
+}
+
+TileCache::Stats TileCache::getStats() const {
+    return {
+        hits_,
+        misses_,
+        loads_,
+        evictions_,
+        writebacks_,
+        prefetch_used_,
+        prefetch_unused_,
+        shared_reads_,
+        tile_bytes_,
+        std::size(resident_),
+        residentBytes(),
+        std::size(cold_),
+        compressed_bytes_,
+        compressions_,
+        decompressions_,
+        compress_seconds_,
+        decompress_seconds_,
+        budget_bytes_,
+        std::size(requested_)};
+}
+
+TileCache::Entry& TileCache::acquire(uint32_t tx, uint32_t ty) {
+    const auto key = TileKey(tx, ty);
+    if (auto found = resident_.find(key); found != std::end(resident_)) {
+        auto& entry = found->second;
+        hits_++;
+        if (entry.prefetched) {
+            entry.prefetched = false;
+            prefetch_used_++;
+        }
+        if (!entry.compressed.empty()) {
+            entry.samples.resize(tile_bytes_ / sizeof(float));
+            if (!decompress(entry, std::data(entry.samples)))
+                file_.readTile(tx, ty, std::data(entry.samples));
+            compressed_bytes_ -= std::size(entry.compressed);
+            entry.compressed = {};
+            lru_.splice(lru_.begin(), cold_, entry.lru);
+        } else {
+            lru_.splice(lru_.begin(), lru_, entry.lru);
+        }
+        entry.used = updates_;
+        return entry;
+    }
+
+    // Materialising a constant tile needs no I/O; any stale read still queued is dropped.
+    if (file_.isConstant(tx, ty))
+        hits_++;
+    else
+        misses_++;
+    {
+        std::unique_lock lock{mutex_};
+        if (reads_.erase(key) > 0)
+            requested_.erase(key);
+        else if (auto found = requested_.find(key); found != std::end(requested_))
+            found->second = false;
+        written_.wait(lock, [this, key] { return !writing_.contains(key); });
+    }
+    static auto& stalls = GlobalMetrics().histogram(
+        "tile_sync_read_seconds", "Reads of tiles needed before they were loaded");
+
+    const auto start = Clock::now();
+    std::vector<float> samples(tile_bytes_ / sizeof(float));
+    file_.readTile(tx, ty, std::data(samples));
+    stalls.recordSeconds(secondsSince(start));
+    return insert(key, std::move(samples), false);
+}
+
+const float* TileCache::constant(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    auto [found, inserted] = constants_.try_emplace(bits);
+    if (inserted)
+        found->second.assign(tile_bytes_ / sizeof(float), value);
+    return std::data(found->second);
+}
+
+TileCache::Entry& TileCache::insert(uint64_t key, std::vector<float> samples, bool prefetched) {
+    lru_.push_front(key);
+    return resident_[key] =
+               Entry{std::move(samples), {}, false, prefetched, updates_, lru_.begin()};
+}
+
+void TileCache::evict(uint64_t key) {
+    auto found  = resident_.find(key);
+    auto& entry = found->second;
+    if (entry.dirty)
+        writeBack(key, entry);
+    if (entry.prefetched)
+        prefetch_unused_++;
+    if (entry.compressed.empty()) {
+        lru_.erase(entry.lru);
+    } else {
+        compressed_bytes_ -= std::size(entry.compressed);
+        cold_.erase(entry.lru);
+    }
+    resident_.erase(found);
+    evictions_++;
+}
+
+void TileCache::compress(Entry& entry) {
+    PROFILE_ZONE("TileCache::compress");
+    const auto start = Clock::now();
+    CompressTile(std::data(entry.samples), file_.getTileSize(), entry.compressed);
+    compress_seconds_ += secondsSince(start);
+    compressions_++;
+    entry.compressed.shrink_to_fit();
+    compressed_bytes_ += std::size(entry.compressed);
+    entry.samples = {};
+    cold_.splice(cold_.begin(), lru_, entry.lru);
+}
+
+bool TileCache::decompress(const Entry& entry, float* samples) {
+    PROFILE_ZONE("TileCache::decompress");
+    static auto& latency =
+        GlobalMetrics().histogram("tile_decompress_seconds", "Decompressions of resident tiles");
+
+    const auto start   = Clock::now();
+    const auto decoded = DecompressTile(
+        std::data(entry.compressed), std::size(entry.compressed), file_.getTileSize(), samples);
+    const auto seconds = secondsSince(start);
+    latency.recordSeconds(seconds);
+    decompress_seconds_ += seconds;
+    decompressions_++;
+    if (!decoded)
+        std::cout << "ERROR::TILE_CACHE::DECOMPRESS_FAILED" << std::endl;
+    return decoded;
+}
+
+void TileCache::writeBack(uint64_t key, const Entry& entry) {
+    auto samples = std::data(entry.samples);
+    std::vector<float> decoded;
+    if (!entry.compressed.empty()) {
+        decoded.resize(tile_bytes_ / sizeof(float));
+        decompress(entry, std::data(decoded));
+        samples = std::data(decoded);
+    }
+    file_.updateStats(uint32_t(key), uint32_t(key >> 32), samples);
+    writebacks_++;
+    if (file_.isConstant(uint32_t(key), uint32_t(key >> 32)))
+        return;
+    auto buffer = TileIO::AllocateBuffer(io_bytes_);
+    std::fill(buffer.get() + file_.getTileBytes(), buffer.get() + io_bytes_, std::byte{});
+    file_.encodeTile(samples, buffer.get());
+    {
+        std::lock_guard lock{mutex_};
+        writing_[key]++;
+        writes_.push_back({key, std::move(buffer)});
+    }
+    condition_.notify_one();
+}
+
+size_t TileCache::residentBytes() const {
+    return (std::size(lru_) + std::size(constants_)) * tile_bytes_ + compressed_bytes_;
+}
+
+void TileCache::run(TileIO::Backend backend, bool direct) {
+    PROFILE_THREAD("Tile IO");
+    auto io = TileIO::Create(file_, backend, direct);
+    std::vector<Job> batch;
+    std::vector<std::pair<float, uint64_t>> urgent;
+    std::vector<TileIO::Request> completed;
+    std::vector<std::pair<uint64_t, std::vector<float>>> loaded;
+
+    while (true) {
+        std::unique_lock lock{mutex_};
+        condition_.wait(lock, [this] { return stop_ || !writes_.empty() || !reads_.empty(); });
+        if (stop_ && writes_.empty())
+            return;
+        while (!writes_.empty() && std::size(batch) < MaxBatch) {
+            batch.push_back(std::move(writes_.front()));
+            writes_.pop_front();
+        }
+        // A read waits for a later batch while write-backs of its tile are queued behind this one,
+        // or it would load the stale tile.
+        const auto queued = [&](uint64_t key) {
+            const auto found = writing_.find(key);
+            if (found == std::end(writing_))
+                return false;
+            auto batched = size_t{};
+            for (auto& job : batch)
+                batched += job.key == key;
+            return found->second > batched;
+        };
+        urgent.clear();
+        for (auto [key, priority] : reads_) {
+            if (!queued(key))
+                urgent.emplace_back(priority, key);
+        }
+        const auto count = std::min(MaxBatch, std::size(urgent));
+        std::partial_sort(urgent.begin(), urgent.begin() + count, urgent.end());
+        for (auto i = size_t{}; i < count; i++) {
+            reads_.erase(urgent[i].second);
+            batch.push_back({urgent[i].second, nullptr});
+        }
+        lock.unlock();
+        PROFILE_ZONE("TileCache::batch");
+
+        // Write-backs go first so that a tile read again right after its eviction sees them.
+        auto writes = size_t{};
+        for (auto& job : batch) {
+            if (job.buffer) {
+                const auto offset = file_.getTileOffset(uint32_t(job.key), uint32_t(job.key >> 32));
+                io->submit({job.key, offset, job.buffer.get(), io_bytes_, true, 0});
+                writes++;
+            }
+        }
+        completed.clear();
+        io->wait(completed, writes);
+        for (auto& request : completed)
+            if (request.result < 0)
+                std::cout << "ERROR::TILE_CACHE::WRITE_FAILED " << -request.result << std::endl;
+        if (writes > 0) {
+            lock.lock();
+            for (auto& job : batch)
+                if (job.buffer && --writing_[job.key] == 0)
+                    writing_.erase(job.key);
+            lock.unlock();
+            written_.notify_all();
+        }
+
+        static auto& latency = GlobalMetrics().histogram(
+            "tile_read_batch_seconds", "Asynchronous reads of a batch of tiles");
+
+        const auto start = Clock::now();
+        auto reads       = size_t{};
+        for (auto& job : batch) {
+            if (!job.buffer) {
+                const auto offset = file_.getTileOffset(uint32_t(job.key), uint32_t(job.key >> 32));
+                job.buffer        = TileIO::AllocateBuffer(io_bytes_);
+                io->submit({job.key, offset, job.buffer.get(), io_bytes_, false, 0});
+                reads++;
+            }
+        }
+        completed.clear();
+        io->wait(completed, reads);
+        if (reads > 0)
+            latency.recordSeconds(secondsSince(start));
+        for (auto& request : completed) {
+            std::vector<float> samples(tile_bytes_ / sizeof(float));
+            if (request.result < 0) {
+                std::cout << "ERROR::TILE_CACHE::READ_FAILED " << -request.result << std::endl;
+                file_.readTile(
+                    uint32_t(request.key), uint32_t(request.key >> 32), std::data(samples));
+            } else {
+                file_.decodeTile(request.buffer, std::data(samples));
+            }
+            loaded.emplace_back(request.key, std::move(samples));
+        }
+        batch.clear();
+
+        lock.lock();
+        std::move(loaded.begin(), loaded.end(), std::back_inserter(completed_));
+        lock.unlock();
+        loaded.clear();
+    }
+}
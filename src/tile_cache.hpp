@@ -0,0 +1,187 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tile_file.hpp"
+#include "tile_io.hpp"
+
+inline uint64_t TileKey(uint32_t tx, uint32_t ty) { return (uint64_t(ty) << 32) | tx; }
+
+// Resident set of decoded tiles of a TileFile, bounded by a memory budget.
+//
+// Tiles are requested asynchronously with a priority (lower loads sooner) and loaded by a worker
+// thread, which issues each batch of queued write-backs and most urgent reads through a TileIO
+// backend at once. Requests the worker has not picked up yet can be cancelled. update()
+// integrates finished loads and evicts least recently used tiles until the budget is met, writing
+// dirty ones back to the file first. read()/write() on a missing tile load it synchronously and
+// count as a miss. Pointers returned by read()/write() stay valid until the next update().
+// Constant tiles are never loaded: read() serves them from one shared buffer per value and
+// write() materialises them. With the mapped backend and Float32 samples, read() of a tile that
+// is not resident points straight into the file mapping instead of copying it.
+// Tiles not accessed for ColdUpdates updates are compressed in memory with the lossless tile
+// codec and decompressed on their next access; compressed tiles are evicted first.
+class TileCache {
+  public:
+    struct Stats {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t loads;
+        uint64_t evictions;
+        uint64_t writebacks;
+        // Asynchronously loaded tiles that were accessed before eviction, or evicted unused.
+        uint64_t prefetch_used;
+        uint64_t prefetch_unused;
+        // Reads served from a shared constant tile or the file mapping without a private copy.
+        uint64_t shared_reads;
+        size_t tile_bytes;
+        size_t resident_tiles;
+        size_t resident_bytes;
+        // Resident tiles held compressed, the memory they take, and codec work so far.
+        size_t compressed_tiles;
+        size_t compressed_bytes;
+        uint64_t compressions;
+        uint64_t decompressions;
+        double compress_seconds;
+        double decompress_seconds;
+        size_t budget_bytes;
+        size_t in_flight;
+
+        double hitRate() const {
+            return hits + misses ? double(hits) / double(hits + misses) : 1.0;
+        }
+        double compressionRatio() const {
+            return compressed_bytes ? double(compressed_tiles * tile_bytes) / compressed_bytes
+                                    : 1.0;
+        }
+        // Codec throughput in MiB/s of uncompressed tiles.
+        double compressRate() const {
+            return compress_seconds > 0.0
+                       ? double(compressions * tile_bytes) / (1 << 20) / compress_seconds
+                       : 0.0;
+        }
+        double decompressRate() const {
+            return decompress_seconds > 0.0
+                       ? double(decompressions * tile_bytes) / (1 << 20) / decompress_seconds
+                       : 0.0;
+        }
+    };
+
+#ifdef __linux__
+    static constexpr auto DefaultBackend = TileIO::Backend::IoUring;
+#elif defined(_WIN32)
+    static constexpr auto DefaultBackend = TileIO::Backend::Mapped;
+#else
+    static constexpr auto DefaultBackend = TileIO::Backend::Pread;
+#endif
+    // Upper bound on the reads or writes the worker keeps in flight at once.
+    static constexpr size_t MaxBatch = 32;
+    // Distinct constant values kept as shared tiles between updates.
+    static constexpr size_t MaxConstants = 16;
+    // Updates without access before a tile is compressed, and compressions per update.
+    static constexpr uint64_t ColdUpdates   = 120;
+    static constexpr size_t MaxCompressions = 8;
+
+    TileCache(
+        TileFile& file,
+        size_t budget_bytes,
+        TileIO::Backend backend = DefaultBackend,
+        bool direct             = false);
+    TileCache(const TileCache&)            = delete;
+    TileCache& operator=(const TileCache&) = delete;
+    ~TileCache();
+
+    const float* read(uint32_t tx, uint32_t ty);
+    float* write(uint32_t tx, uint32_t ty);
+
+    bool isResident(uint32_t tx, uint32_t ty) const;
+    // Queues an asynchronous load, or reprioritises one that is still queued.
+    void request(uint32_t tx, uint32_t ty, float priority = 0.0f);
+    // Drops a queued load; returns false if it is already in flight or was never requested.
+    bool cancel(uint32_t tx, uint32_t ty);
+
+    void update();
+    void flush();
+
+    const TileFile& getFile() const { return file_; }
+    void setBudget(size_t budget_bytes) { budget_bytes_ = budget_bytes; }
+    Stats getStats() const;
+
+  private:
+    struct Entry {
+        // Empty while the tile is held compressed.
+        std::vector<float> samples;
+        std::vector<uint8_t> compressed;
+        bool dirty;
+        // Loaded asynchronously and not accessed yet.
+        bool prefetched;
+        // The update() count at the last access.
+        uint64_t used;
+        // Position in lru_, or in cold_ while compressed.
+        std::list<uint64_t>::iterator lru;
+    };
+
+    struct Job {
+        uint64_t key;
+        // Encoded tile for write-backs, empty for reads.
+        TileIO::Buffer buffer;
+    };
+
+    Entry& acquire(uint32_t tx, uint32_t ty);
+    const float* constant(float value);
+    Entry& insert(uint64_t key, std::vector<float> samples, bool prefetched);
+    void evict(uint64_t key);
+    void compress(Entry& entry);
+    bool decompress(const Entry& entry, float* samples);
+    void writeBack(uint64_t key, const Entry& entry);
+    size_t residentBytes() const;
+    void run(TileIO::Backend backend, bool direct);
+
+    TileFile& file_;
+    size_t tile_bytes_;
+    size_t io_bytes_;
+    size_t budget_bytes_;
+    bool references_;
+
+    std::unordered_map<uint64_t, Entry> resident_;
+    // Shared tiles of constant samples, by the bits of their value.
+    std::unordered_map<uint32_t, std::vector<float>> constants_;
+    std::list<uint64_t> lru_;
+    std::list<uint64_t> cold_;
+    size_t compressed_bytes_ = 0;
+    uint64_t updates_        = 0;
+    // Requests handed to the worker; false once a synchronous load made the result stale.
+    std::unordered_map<uint64_t, bool> requested_;
+
+    uint64_t hits_             = 0;
+    uint64_t misses_           = 0;
+    uint64_t loads_            = 0;
+    uint64_t evictions_        = 0;
+    uint64_t writebacks_       = 0;
+    uint64_t prefetch_used_    = 0;
+    uint64_t prefetch_unused_  = 0;
+    uint64_t shared_reads_     = 0;
+    uint64_t compressions_     = 0;
+    uint64_t decompressions_   = 0;
+    double compress_seconds_   = 0.0;
+    double decompress_seconds_ = 0.0;
+
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::condition_variable written_;
+    // Queued reads by priority, and queued write-backs in eviction order.
+    std::unordered_map<uint64_t, float> reads_;
+    std::deque<Job> writes_;
+    std::vector<std::pair<uint64_t, std::vector<float>>> completed_;
+    // Write-backs not yet on disk; a synchronous load of one of these waits for it.
+    std::unordered_map<uint64_t, size_t> writing_;
+    bool stop_ = false;
+    std::thread worker_;
+};
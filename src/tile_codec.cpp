@@ -0,0 +1,226 @@
+#include "tile_codec.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace {
+// Quotients from here on are escaped and followed by the raw residual.
+constexpr uint32_t MaxQuotient = 24;
+// The running means is halved after this many samples to follow local detail.
+constexpr uint32_t ResetInterval = 64;
+constexpr uint32_t OutlierShift  = 2;
+// First byte of a compressed tile; tiles that do not shrink are stored raw.
+constexpr uint8_t Coded = 0;
+constexpr uint8_t Raw   = 1;
+
+// Flips the bits of negative floats so that integer order matches float order.
+uint32_t toOrdered(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+float fromOrdered(uint32_t ordered) {
+    const auto bits = ordered & 0x80000000u ? ordered & 0x7fffffffu : ~ordered;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Predicting in float arithmetic keeps residuals small where the spacing of floats changes,
+// e.g. around zero; encoder and decoder evaluate the same expression on the same samples.
+float predict(const float* samples, uint32_t tile_size, size_t i) {
+    const auto x = i % tile_size;
+    if (i < tile_size)
+        return x > 0 ? samples[i - 1] : 0.0f;
+    if (x == 0)
+        return samples[i - tile_size];
+    return samples[i - 1] + samples[i - tile_size] - samples[i - tile_size - 1];
+}
+
+// Rice parameter for the running mean of the coded values.
+class Adaptive {
+  public:
+    uint32_t parameter() const {
+        auto k = 0u;
+        while (k < 31 && (uint64_t(count_) << k) < sum_)
+            k++;
+        return k;
+    }
+
+    // A single outlier, like the edge of a brushed plateau, moves the mean by a bounded factor.
+    void update(uint32_t value) {
+        sum_ += std::min<uint64_t>(value, (sum_ / count_ + 1) << OutlierShift);
+        if (++count_ == ResetInterval) {
+            sum_ /= 2;
+            count_ /= 2;
+        }
+    }
+
+  private:
+    uint64_t sum_   = 0;
+    uint32_t count_ = 1;
+};
+
+class BitWriter {
+  public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_{out} {}
+
+    void put(uint32_t value, uint32_t bits) {
+        bits_ |= uint64_t(value & (bits == 32 ? ~0u : (1u << bits) - 1)) << used_;
+        for (used_ += bits; used_ >= 8; used_ -= 8, bits_ >>= 8)
+            out_.push_back(uint8_t(bits_));
+    }
+
+    void rice(uint32_t value, uint32_t k) {
+        if (const auto quotient = value >> k; quotient < MaxQuotient) {
+            put((1u << quotient) - 1, quotient + 1);
+            put(value, k);
+        } else {
+            put((1u << MaxQuotient) - 1, MaxQuotient);
+            put(value, 32);
+        }
+    }
+
+    void finish() {
+        if (used_ > 0)
+            out_.push_back(uint8_t(bits_));
+    }
+
+  private:
+    std::vector<uint8_t>& out_;
+    uint64_t bits_ = 0;
+    uint32_t used_ = 0;
+};
+
+class BitReader {
+  public:
+    BitReader(const uint8_t* data, const uint8_t* end) : data_{data}, end_{end} {}
+
+    bool get(uint32_t bits, uint32_t& value) {
+        refill();
+        if (available_ < bits)
+            return false;
+        value = uint32_t(bits_ & ((uint64_t{1} << bits) - 1));
+        consume(bits);
+        return true;
+    }
+
+    bool rice(uint32_t k, uint32_t& value) {
+        refill();
+        const auto ones = std::min<uint32_t>(std::countr_one(bits_), MaxQuotient);
+        if (ones >= available_)
+            return false;
+        if (ones == MaxQuotient) {
+            consume(ones);
+            return get(32, value);
+        }
+        consume(ones + 1);
+        if (!get(k, value))
+            return false;
+        value |= ones << k;
+        return true;
+    }
+
+  private:
+    void refill() {
+        for (; available_ <= 56 && data_ != end_; available_ += 8)
+            bits_ |= uint64_t(*data_++) << available_;
+    }
+
+    void consume(uint32_t bits) {
+        bits_ = bits < 64 ? bits_ >> bits : 0;
+        available_ -= bits;
+    }
+
+    const uint8_t* data_;
+    const uint8_t* end_;
+    uint64_t bits_      = 0;
+    uint32_t available_ = 0;
+};
+} // namespace
+
+// Residuals are Rice coded with an adaptive parameter. Whenever that parameter drops to zero the
+// coder switches to run mode: it codes how many exact predictions follow, then codes the sample
+// ending the run normally.
+void CompressTile(const float* samples, uint32_t tile_size, std::vector<uint8_t>& out) {
+    out.assign(1, Coded);
+    BitWriter writer{out};
+    Adaptive residuals;
+    Adaptive runs;
+    const auto count = size_t(tile_size) * tile_size;
+    auto after_run   = false;
+    for (auto i = size_t{}; i < count;) {
+        const auto k = residuals.parameter();
+        if (k == 0 && !after_run) {
+            auto run = uint32_t{};
+            // Compares bits, so -0 and 0 stay distinct.
+            while (i < count
+                   && toOrdered(samples[i]) == toOrdered(predict(samples, tile_size, i))) {
+                residuals.update(0);
+                run++;
+                i++;
+            }
+            writer.rice(run, runs.parameter());
+            runs.update(run);
+            after_run = true;
+            continue;
+        }
+        const auto predicted = toOrdered(predict(samples, tile_size, i));
+        const auto residual  = int32_t(toOrdered(samples[i]) - predicted);
+        const auto zigzag    = (uint32_t(residual) << 1) ^ uint32_t(residual >> 31);
+        writer.rice(zigzag, k);
+        residuals.update(zigzag);
+        after_run = false;
+        i++;
+    }
+    writer.finish();
+
+    const auto bytes = size_t(tile_size) * tile_size * sizeof(float);
+    if (std::size(out) > bytes) {
+        out.assign(1, Raw);
+        const auto raw = reinterpret_cast<const uint8_t*>(samples);
+        out.insert(out.end(), raw, raw + bytes);
+    }
+}
+
+bool DecompressTile(const uint8_t* data, size_t size, uint32_t tile_size, float* samples) {
+    if (size == 0)
+        return false;
+    const auto count = size_t(tile_size) * tile_size;
+    if (data[0] == Raw) {
+        if (size != 1 + count * sizeof(float))
+            return false;
+        std::memcpy(samples, data + 1, count * sizeof(float));
+        return true;
+    }
+    BitReader reader{data + 1, data + size};
+    Adaptive residuals;
+    Adaptive runs;
+    auto after_run = false;
+    for (auto i = size_t{}; i < count;) {
+        const auto k = residuals.parameter();
+        if (k == 0 && !after_run) {
+            uint32_t run;
+            if (!reader.rice(runs.parameter(), run) || run > count - i)
+                return false;
+            runs.update(run);
+            for (const auto end = i + run; i < end; i++) {
+                samples[i] = predict(samples, tile_size, i);
+                residuals.update(0);
+            }
+            after_run = true;
+            continue;
+        }
+        uint32_t zigzag;
+        if (!reader.rice(k, zigzag))
+            return false;
+        residuals.update(zigzag);
+        const auto residual = (zigzag >> 1) ^ (0u - (zigzag & 1));
+        samples[i]          = fromOrdered(toOrdered(predict(samples, tile_size, i)) + residual);
+        after_run           = false;
+        i++;
+    }
+    return true;
+}
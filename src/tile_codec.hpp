@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lossless codec for square tiles of smooth height samples.
+//
+// Each sample is predicted from its left, upper and upper-left neighbours (left + up - upper
+// left) and the difference between the float bit patterns, which order like the floats, is Rice
+// coded with a parameter that follows the local detail. Runs of exact predictions collapse to a
+// single run length. Smooth terrain leaves residuals of a few significant bits and flat or
+// brushed areas collapse to runs; tiles that would grow are stored raw.
+void CompressTile(const float* samples, uint32_t tile_size, std::vector<uint8_t>& out);
+// Returns false if `data` is not a complete tile of tile_size * tile_size samples.
+bool DecompressTile(const uint8_t* data, size_t size, uint32_t tile_size, float* samples);
@@ -0,0 +1,498 @@
+#include "tile_file.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "quantization.hpp"
+
+struct TileFile::Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t tile_size;
+    Format format;
+    float min_height;
+    float max_height;
+    uint32_t tiles_x;
+    uint32_t tiles_y;
+    uint32_t levels;
+    uint32_t reserved;
+    uint64_t index_offset;
+    uint64_t pyramid_offset;
+    uint64_t data_offset;
+};
+
+namespace {
+constexpr char Magic[4]     = {'T', 'V', 'H', 'M'};
+// Version 2 added constant tiles.
+constexpr uint32_t Version  = 2;
+constexpr uint64_t PageSize = 4096;
+// Index entries of constant tiles carry this bit on top of the offset their data would use.
+constexpr uint64_t ConstantTile = uint64_t{1} << 63;
+
+auto alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+auto sampleBytes(TileFile::Format format) -> size_t {
+    return format == TileFile::Format::UInt16 ? sizeof(uint16_t) : sizeof(float);
+}
+
+auto levelSize(uint32_t tiles, uint32_t level) {
+    return std::max(1u, (tiles + (1u << level) - 1) >> level);
+}
+
+auto levelCount(uint32_t tiles_x, uint32_t tiles_y) {
+    auto levels = 1u;
+    while (levelSize(tiles_x, levels - 1) > 1 || levelSize(tiles_y, levels - 1) > 1)
+        levels++;
+    return levels;
+}
+
+auto combine(const TileStats& a, const TileStats& b) {
+    if (a.samples == 0)
+        return b;
+    if (b.samples == 0)
+        return a;
+    auto samples = a.samples + b.samples;
+    return TileStats{
+        std::min(a.min, b.min),
+        std::max(a.max, b.max),
+        static_cast<float>(
+            (double(a.average) * a.samples + double(b.average) * b.samples) / samples),
+        samples};
+}
+} // namespace
+
+TileFile::TileFile(TileFile&& other) noexcept { *this = std::move(other); }
+
+TileFile& TileFile::operator=(TileFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        path_     = std::move(other.path_);
+        data_     = std::exchange(other.data_, nullptr);
+        size_     = std::exchange(other.size_, 0);
+        header_   = std::exchange(other.header_, nullptr);
+        writable_ = std::exchange(other.writable_, false);
+#ifdef _WIN32
+        file_    = std::exchange(other.file_, nullptr);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+#else
+        fd_ = std::exchange(other.fd_, -1);
+#endif
+    }
+    return *this;
+}
+
+TileFile::~TileFile() { close(); }
+
+bool TileFile::Create(
+    const std::filesystem::path& path,
+    uint32_t width,
+    uint32_t height,
+    const float* heights,
+    Format format,
+    uint32_t tile_size,
+    float min_height,
+    float max_height) {
+    if (width == 0 || height == 0 || tile_size == 0) {
+        std::cout << "ERROR::TILE_FILE::INVALID_DIMENSIONS" << std::endl;
+        return false;
+    }
+
+    const auto tiles_x     = (width + tile_size - 1) / tile_size;
+    const auto tiles_y     = (height + tile_size - 1) / tile_size;
+    const auto levels      = levelCount(tiles_x, tiles_y);
+    const auto tile_stride =
+        alignUp(uint64_t(tile_size) * tile_size * sampleBytes(format), PageSize);
+
+    auto nodes = uint64_t{};
+    for (auto level = 0u; level < levels; level++)
+        nodes += uint64_t(levelSize(tiles_x, level)) * levelSize(tiles_y, level);
+
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version        = Version;
+    header.width          = width;
+    header.height         = height;
+    header.tile_size      = tile_size;
+    header.format         = format;
+    header.min_height     = min_height;
+    header.max_height     = max_height;
+    header.tiles_x        = tiles_x;
+    header.tiles_y        = tiles_y;
+    header.levels         = levels;
+    header.index_offset   = sizeof(Header);
+    header.pyramid_offset = header.index_offset + uint64_t(tiles_x) * tiles_y * sizeof(uint64_t);
+    header.data_offset    = alignUp(header.pyramid_offset + nodes * sizeof(TileStats), PageSize);
+
+    const auto size = header.data_offset + uint64_t(tiles_x) * tiles_y * tile_stride;
+
+    {
+        std::ofstream(path, std::ios::binary | std::ios::trunc);
+    }
+    std::error_code error;
+    std::filesystem::resize_file(path, size, error);
+    if (error) {
+        std::cout << "ERROR::TILE_FILE::RESIZE_FAILED " << path.string() << ": " << error.message()
+                  << std::endl;
+        return false;
+    }
+
+    TileFile file;
+    if (!file.map(path, true))
+        return false;
+    std::memcpy(file.header_, &header, sizeof(Header));
+
+    // Assign storage in Morton order; the index itself stays row-major for direct lookup.
+    std::vector<uint32_t> order(size_t(tiles_x) * tiles_y);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [tiles_x](auto a, auto b) {
+        return MortonEncode(a % tiles_x, a / tiles_x) < MortonEncode(b % tiles_x, b / tiles_x);
+    });
+    auto index = reinterpret_cast<uint64_t*>(file.data_ + header.index_offset);
+    for (auto slot = size_t{}; slot < std::size(order); slot++)
+        index[order[slot]] = header.data_offset + slot * tile_stride;
+
+    std::vector<float> tile(size_t(tile_size) * tile_size);
+    for (auto tile_index : order) {
+        const auto tx = tile_index % tiles_x;
+        const auto ty = tile_index / tiles_x;
+        std::fill(tile.begin(), tile.end(), 0.0f);
+        if (heights) {
+            for (auto y = 0u; y < tile_size && ty * tile_size + y < height; y++) {
+                const auto row   = size_t(ty * tile_size + y) * width + tx * tile_size;
+                const auto count = std::min(tile_size, width - tx * tile_size);
+                std::copy_n(heights + row, count, tile.data() + size_t(y) * tile_size);
+            }
+        }
+        file.writeTile(tx, ty, tile.data());
+    }
+    file.flush();
+    return true;
+}
+
+bool TileFile::open(const std::filesystem::path& path, bool writable) {
+    if (!map(path, writable))
+        return false;
+    if (!validate()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool TileFile::map(const std::filesystem::path& path, bool writable) {
+    close();
+
+    std::error_code error;
+    const auto size = std::filesystem::file_size(path, error);
+    if (error || size < sizeof(Header)) {
+        std::cout << "ERROR::TILE_FILE::NOT_FOUND " << path.string() << std::endl;
+        return false;
+    }
+
+#ifdef _WIN32
+    file_ = CreateFileW(
+        path.c_str(),
+        GENERIC_READ | (writable ? GENERIC_WRITE : 0),
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) {
+        file_ = nullptr;
+        std::cout << "ERROR::TILE_FILE::OPEN_FAILED " << path.string() << std::endl;
+        return false;
+    }
+    mapping_ = CreateFileMappingW(
+        file_, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+    auto view = mapping_ ? MapViewOfFile(
+                               mapping_, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0)
+                         : nullptr;
+    if (!view) {
+        std::cout << "ERROR::TILE_FILE::MAP_FAILED " << path.string() << std::endl;
+        if (mapping_)
+            CloseHandle(mapping_);
+        CloseHandle(file_);
+        mapping_ = file_ = nullptr;
+        return false;
+    }
+#else
+    fd_ = ::open(path.c_str(), writable ? O_RDWR : O_RDONLY);
+    if (fd_ < 0) {
+        std::cout << "ERROR::TILE_FILE::OPEN_FAILED " << path.string() << std::endl;
+        return false;
+    }
+    auto view = mmap(
+        nullptr, size, PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, fd_, 0);
+    if (view == MAP_FAILED) {
+        std::cout << "ERROR::TILE_FILE::MAP_FAILED " << path.string() << std::endl;
+        ::close(fd_);
+        fd_ = -1;
+        return false;
+    }
+#endif
+
+    path_     = path;
+    data_     = static_cast<std::byte*>(view);
+    size_     = size;
+    header_   = reinterpret_cast<Header*>(data_);
+    writable_ = writable;
+    return true;
+}
+
+bool TileFile::validate() const {
+    const auto& header = *header_;
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+        std::cout << "ERROR::TILE_FILE::BAD_MAGIC " << path_.string() << std::endl;
+        return false;
+    }
+    if (header.version == 0 || header.version > Version) {
+        std::cout << "ERROR::TILE_FILE::UNSUPPORTED_VERSION " << header.version << " "
+                  << path_.string() << std::endl;
+        return false;
+    }
+
+    // Offsets and lengths come from the file, so compare without overflowing.
+    const auto fits = [this](uint64_t offset, uint64_t count, uint64_t bytes) {
+        return offset <= size_ && count <= (size_ - offset) / bytes;
+    };
+    const auto bad_header = [this] {
+        std::cout << "ERROR::TILE_FILE::BAD_HEADER " << path_.string() << std::endl;
+        return false;
+    };
+    if (header.width == 0 || header.height == 0 || header.tile_size == 0)
+        return bad_header();
+    const auto tiles_x = (uint64_t(header.width) + header.tile_size - 1) / header.tile_size;
+    const auto tiles_y = (uint64_t(header.height) + header.tile_size - 1) / header.tile_size;
+    if (header.tiles_x != tiles_x || header.tiles_y != tiles_y
+        || header.levels != levelCount(header.tiles_x, header.tiles_y)
+        || (header.format != Format::Float32 && header.format != Format::UInt16)
+        || !fits(0, uint64_t(header.tile_size) * header.tile_size, sampleBytes(header.format)))
+        return bad_header();
+
+    auto nodes = uint64_t{};
+    for (auto level = 0u; level < header.levels; level++)
+        nodes += uint64_t(levelSize(header.tiles_x, level)) * levelSize(header.tiles_y, level);
+    const auto tiles = tiles_x * tiles_y;
+    if (header.index_offset % alignof(uint64_t) != 0
+        || header.pyramid_offset % alignof(TileStats) != 0
+        || !fits(header.index_offset, tiles, sizeof(uint64_t))
+        || !fits(header.pyramid_offset, nodes, sizeof(TileStats))) {
+        std::cout << "ERROR::TILE_FILE::TRUNCATED " << path_.string() << std::endl;
+        return false;
+    }
+    const auto index = reinterpret_cast<const uint64_t*>(data_ + header.index_offset);
+    for (auto tile = uint64_t{}; tile < tiles; tile++) {
+        if (!fits(index[tile] & ~ConstantTile, 1, getTileBytes())) {
+            std::cout << "ERROR::TILE_FILE::TRUNCATED " << path_.string() << " at tile " << tile
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void TileFile::close() {
+    if (!data_)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    CloseHandle(file_);
+    mapping_ = file_ = nullptr;
+#else
+    munmap(data_, size_);
+    ::close(fd_);
+    fd_ = -1;
+#endif
+    data_   = nullptr;
+    header_ = nullptr;
+    size_   = 0;
+}
+
+void TileFile::flush() {
+    if (!data_ || !writable_)
+        return;
+#ifdef _WIN32
+    FlushViewOfFile(data_, 0);
+#else
+    msync(data_, size_, MS_ASYNC);
+#endif
+}
+
+uint32_t TileFile::getWidth() const { return header_->width; }
+
+uint32_t TileFile::getHeight() const { return header_->height; }
+
+uint32_t TileFile::getTileSize() const { return header_->tile_size; }
+
+uint32_t TileFile::getTilesX() const { return header_->tiles_x; }
+
+uint32_t TileFile::getTilesY() const { return header_->tiles_y; }
+
+uint32_t TileFile::getLevels() const { return header_->levels; }
+
+TileFile::Format TileFile::getFormat() const { return header_->format; }
+
+float TileFile::getMinHeight() const { return header_->min_height; }
+
+float TileFile::getMaxHeight() const { return header_->max_height; }
+
+size_t TileFile::getTileBytes() const {
+    return size_t(header_->tile_size) * header_->tile_size * sampleBytes(header_->format);
+}
+
+uint64_t TileFile::getTileOffset(uint32_t tx, uint32_t ty) const {
+    return indexEntry(tx, ty) & ~ConstantTile;
+}
+
+bool TileFile::isConstant(uint32_t tx, uint32_t ty) const {
+    return indexEntry(tx, ty) & ConstantTile;
+}
+
+uint64_t& TileFile::indexEntry(uint32_t tx, uint32_t ty) const {
+    auto index = reinterpret_cast<uint64_t*>(data_ + header_->index_offset);
+    return index[size_t(ty) * header_->tiles_x + tx];
+}
+
+uint64_t TileFile::levelOffset(uint32_t level) const {
+    auto offset = header_->pyramid_offset;
+    for (auto l = 0u; l < level; l++)
+        offset += uint64_t(levelSize(header_->tiles_x, l)) * levelSize(header_->tiles_y, l)
+                  * sizeof(TileStats);
+    return offset;
+}
+
+const TileStats& TileFile::getStats(uint32_t level, uint32_t x, uint32_t y) const {
+    auto nodes = reinterpret_cast<const TileStats*>(data_ + levelOffset(level));
+    return nodes[size_t(y) * levelSize(header_->tiles_x, level) + x];
+}
+
+TileStats& TileFile::stats(uint32_t level, uint32_t x, uint32_t y) {
+    return const_cast<TileStats&>(std::as_const(*this).getStats(level, x, y));
+}
+
+void TileFile::decodeTile(const std::byte* raw, float* out) const {
+    const auto count = size_t(header_->tile_size) * header_->tile_size;
+    if (header_->format == Format::Float32) {
+        std::memcpy(out, raw, count * sizeof(float));
+        return;
+    }
+    Dequantize(
+        reinterpret_cast<const uint16_t*>(raw),
+        count,
+        Quantization::Fit(header_->min_height, header_->max_height),
+        out);
+}
+
+void TileFile::encodeTile(const float* in, std::byte* raw) const {
+    const auto count = size_t(header_->tile_size) * header_->tile_size;
+    if (header_->format == Format::Float32) {
+        std::memcpy(raw, in, count * sizeof(float));
+        return;
+    }
+    Quantize(
+        in,
+        count,
+        Quantization::Fit(header_->min_height, header_->max_height),
+        reinterpret_cast<uint16_t*>(raw));
+}
+
+void TileFile::readTile(uint32_t tx, uint32_t ty, float* out) const {
+    if (isConstant(tx, ty))
+        std::fill_n(out, size_t(header_->tile_size) * header_->tile_size, getConstant(tx, ty));
+    else
+        decodeTile(data_ + getTileOffset(tx, ty), out);
+}
+
+void TileFile::writeTile(uint32_t tx, uint32_t ty, const float* in) {
+    updateStats(tx, ty, in);
+    if (!isConstant(tx, ty))
+        encodeTile(in, data_ + getTileOffset(tx, ty));
+}
+
+float TileFile::sample(uint32_t x, uint32_t y) const {
+    const auto tile_size = header_->tile_size;
+    if (isConstant(x / tile_size, y / tile_size))
+        return getConstant(x / tile_size, y / tile_size);
+    auto raw             = data_ + getTileOffset(x / tile_size, y / tile_size);
+    const auto i         = size_t(y % tile_size) * tile_size + x % tile_size;
+    if (header_->format == Format::Float32) {
+        float value;
+        std::memcpy(&value, raw + i * sizeof(float), sizeof(float));
+        return value;
+    }
+    uint16_t value;
+    std::memcpy(&value, raw + i * sizeof(uint16_t), sizeof(uint16_t));
+    float height;
+    Dequantize(&value, 1, Quantization::Fit(header_->min_height, header_->max_height), &height);
+    return height;
+}
+
+void TileFile::updateStats(uint32_t tx, uint32_t ty, const float* samples) {
+    const auto tile_size = header_->tile_size;
+    const auto columns   = std::min(tile_size, header_->width - tx * tile_size);
+    const auto rows      = std::min(tile_size, header_->height - ty * tile_size);
+
+    auto node = TileStats{
+        std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest(), 0.0f, 0};
+    auto sum = 0.0;
+    for (auto y = 0u; y < rows; y++) {
+        for (auto x = 0u; x < columns; x++) {
+            const auto value = samples[size_t(y) * tile_size + x];
+            node.min         = std::min(node.min, value);
+            node.max         = std::max(node.max, value);
+            sum += value;
+        }
+    }
+    node.samples = columns * rows;
+    node.average = static_cast<float>(sum / node.samples);
+    stats(0, tx, ty) = node;
+
+    auto& entry = indexEntry(tx, ty);
+    if (node.min != node.max) {
+        entry &= ~ConstantTile;
+    } else if (!(entry & ConstantTile)) {
+        entry |= ConstantTile;
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+        // Give the stale data pages back to the file system.
+        fallocate(
+            fd_,
+            FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+            off_t(entry & ~ConstantTile),
+            off_t(alignUp(getTileBytes(), PageSize)));
+#endif
+    }
+
+    for (auto level = 1u; level < header_->levels; level++) {
+        tx /= 2;
+        ty /= 2;
+        auto parent = TileStats{};
+        for (auto y = 2 * ty; y < std::min(2 * ty + 2, levelSize(header_->tiles_y, level - 1)); y++)
+            for (auto x = 2 * tx; x < std::min(2 * tx + 2, levelSize(header_->tiles_x, level - 1));
+                 x++)
+                parent = combine(parent, getStats(level - 1, x, y));
+        stats(level, tx, ty) = parent;
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// Native tiled heightmap format.
+//
+// Layout: header | tile index | mip pyramid | tile data. Tiles are square (padded at the right and
+// bottom edges), page aligned and stored in Morton order so that neighbouring tiles live on nearby
+// pages. The index maps a row-major tile coordinate to its byte offset, and the pyramid holds the
+// min/max/average of every tile at level 0 and of every 2x2 block of the level below above that.
+// The whole file is memory mapped, so only the pages of tiles that are read or written get touched.
+// A tile whose samples are all equal is flagged in the index and stored as its pyramid value
+// alone: its data pages are never written (or are punched out again), so flat regions cost no
+// disk space and are materialised only when written with varying heights.
+
+inline uint64_t MortonEncode(uint32_t x, uint32_t y) {
+    auto spread = [](uint64_t v) {
+        v = (v | (v << 16)) & 0x0000ffff0000ffffull;
+        v = (v | (v << 8)) & 0x00ff00ff00ff00ffull;
+        v = (v | (v << 4)) & 0x0f0f0f0f0f0f0f0full;
+        v = (v | (v << 2)) & 0x3333333333333333ull;
+        v = (v | (v << 1)) & 0x5555555555555555ull;
+        return v;
+    };
+    return spread(x) | (spread(y) << 1);
+}
+
+struct TileStats {
+    float min;
+    float max;
+    float average;
+    uint32_t samples;
+};
+
+class TileFile {
+  public:
+    enum class Format : uint32_t { Float32, UInt16 };
+
+    static constexpr uint32_t DefaultTileSize = 256;
+
+    TileFile() = default;
+    TileFile(const TileFile&)            = delete;
+    TileFile& operator=(const TileFile&) = delete;
+    TileFile(TileFile&& other) noexcept;
+    TileFile& operator=(TileFile&& other) noexcept;
+    ~TileFile();
+
+    // Writes a new map. `heights` is row-major width * height samples, or null for a flat map.
+    // UInt16 samples are quantised over [min_height, max_height].
+    static bool Create(
+        const std::filesystem::path& path,
+        uint32_t width,
+        uint32_t height,
+        const float* heights,
+        Format format      = Format::Float32,
+        uint32_t tile_size = DefaultTileSize,
+        float min_height   = -10.f,
+        float max_height   = 10.f);
+
+    bool open(const std::filesystem::path& path, bool writable = true);
+    void close();
+    void flush();
+
+    bool isOpen() const { return header_ != nullptr; }
+
+    uint32_t getWidth() const;
+    uint32_t getHeight() const;
+    uint32_t getTileSize() const;
+    uint32_t getTilesX() const;
+    uint32_t getTilesY() const;
+    uint32_t getLevels() const;
+    Format getFormat() const;
+    float getMinHeight() const;
+    float getMaxHeight() const;
+    size_t getTileBytes() const;
+    uint64_t getTileOffset(uint32_t tx, uint32_t ty) const;
+    bool isConstant(uint32_t tx, uint32_t ty) const;
+    // The value of every sample of a constant tile.
+    float getConstant(uint32_t tx, uint32_t ty) const { return getStats(0, tx, ty).min; }
+    const std::filesystem::path& getPath() const { return path_; }
+    std::byte* getData() const { return data_; }
+
+    const TileStats& getStats(uint32_t level, uint32_t x, uint32_t y) const;
+
+    // Tiles are exchanged as tile_size * tile_size row-major floats.
+    void readTile(uint32_t tx, uint32_t ty, float* out) const;
+    void writeTile(uint32_t tx, uint32_t ty, const float* in);
+
+    void decodeTile(const std::byte* raw, float* out) const;
+    void encodeTile(const float* in, std::byte* raw) const;
+
+    float sample(uint32_t x, uint32_t y) const;
+
+    // Refreshes the pyramid and the constant flag after tile data was written behind the
+    // mapping's back. Tile data only needs writing if the tile did not turn out constant.
+    void updateStats(uint32_t tx, uint32_t ty, const float* samples);
+
+  private:
+    struct Header;
+
+    // Maps the file without looking at its header, which Create fills in right after.
+    bool map(const std::filesystem::path& path, bool writable);
+    // Checks the header, index and pyramid against the mapping's size.
+    bool validate() const;
+
+    TileStats& stats(uint32_t level, uint32_t x, uint32_t y);
+    uint64_t& indexEntry(uint32_t tx, uint32_t ty) const;
+    uint64_t levelOffset(uint32_t level) const;
+
+    std::filesystem::path path_;
+    std::byte* data_ = nullptr;
+    size_t size_     = 0;
+    Header* header_  = nullptr;
+    bool writable_   = false;
+#ifdef _WIN32
+    void* file_    = nullptr;
+    void* mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
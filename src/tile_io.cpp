@@ -0,0 +1,325 @@
+#include "tile_io.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <iostream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define TILE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+class MappedTileIO : public TileIO {
+  public:
+    explicit MappedTileIO(TileFile& file) : file_{file} {}
+
+    Backend getBackend() const override { return Backend::Mapped; }
+
+    void submit(const Request& request) override { queue_.push_back(request); }
+
+    size_t wait(std::vector<Request>& completed, size_t min_completions) override {
+        auto count = size_t{};
+        while (!queue_.empty() && (count < min_completions || count == 0)) {
+            auto request = queue_.front();
+            queue_.pop_front();
+            if (request.write)
+                std::memcpy(file_.getData() + request.offset, request.buffer, request.bytes);
+            else
+                std::memcpy(request.buffer, file_.getData() + request.offset, request.bytes);
+            request.result = int64_t(request.bytes);
+            completed.push_back(request);
+            count++;
+        }
+        return count;
+    }
+
+    size_t getInFlight() const override { return std::size(queue_); }
+
+  private:
+    TileFile& file_;
+    std::deque<Request> queue_;
+};
+
+#ifndef _WIN32
+auto openFile(const TileFile& file, bool direct) {
+    auto flags = O_RDWR;
+#ifdef O_DIRECT
+    if (direct)
+        flags |= O_DIRECT;
+#endif
+    return ::open(file.getPath().c_str(), flags);
+}
+
+class PreadTileIO : public TileIO {
+  public:
+    PreadTileIO(int fd, bool direct) : fd_{fd}, direct_{direct} {}
+    ~PreadTileIO() override { ::close(fd_); }
+
+    Backend getBackend() const override { return Backend::Pread; }
+    bool isDirect() const override { return direct_; }
+
+    void submit(const Request& request) override { queue_.push_back(request); }
+
+    size_t wait(std::vector<Request>& completed, size_t min_completions) override {
+        auto count = size_t{};
+        while (!queue_.empty() && (count < min_completions || count == 0)) {
+            auto request = queue_.front();
+            queue_.pop_front();
+            auto done = size_t{};
+            while (done < request.bytes) {
+                auto result = request.write ? ::pwrite(
+                                                  fd_,
+                                                  request.buffer + done,
+                                                  request.bytes - done,
+                                                  off_t(request.offset + done))
+                                            : ::pread(
+                                                  fd_,
+                                                  request.buffer + done,
+                                                  request.bytes - done,
+                                                  off_t(request.offset + done));
+                if (result < 0 && errno == EINTR)
+                    continue;
+                if (result <= 0)
+                    break;
+                done += size_t(result);
+            }
+            request.result = done == request.bytes ? int64_t(done) : -int64_t(EIO);
+            completed.push_back(request);
+            count++;
+        }
+        return count;
+    }
+
+    size_t getInFlight() const override { return std::size(queue_); }
+
+  private:
+    int fd_;
+    bool direct_;
+    std::deque<Request> queue_;
+};
+#endif
+
+#ifdef TILE_IO_URING
+class UringTileIO : public TileIO {
+  public:
+    static constexpr unsigned Entries = 64;
+
+    static std::unique_ptr<UringTileIO> Create(int fd, bool direct) {
+        io_uring_params params{};
+        auto ring = int(syscall(__NR_io_uring_setup, Entries, &params));
+        if (ring < 0)
+            return nullptr;
+        auto io = std::unique_ptr<UringTileIO>(new UringTileIO(fd, direct, ring, params));
+        if (!io->sq_ring_ || !io->cq_ring_ || !io->sqes_) {
+            // The caller keeps the file descriptor for its fallback.
+            io->fd_ = -1;
+            return nullptr;
+        }
+        return io;
+    }
+
+    ~UringTileIO() override {
+        if (sqes_)
+            munmap(sqes_, sqes_size_);
+        if (cq_ring_ && cq_ring_ != sq_ring_)
+            munmap(cq_ring_, cq_ring_size_);
+        if (sq_ring_)
+            munmap(sq_ring_, sq_ring_size_);
+        ::close(ring_);
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    Backend getBackend() const override { return Backend::IoUring; }
+    bool isDirect() const override { return direct_; }
+
+    void submit(const Request& request) override {
+        while (free_.empty())
+            reap(1);
+
+        const auto slot = free_.back();
+        free_.pop_back();
+        slots_[slot] = request;
+
+        const auto tail  = *sq_tail_;
+        const auto index = tail & *sq_mask_;
+        auto& sqe        = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode    = request.write ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe.fd        = fd_;
+        sqe.addr      = reinterpret_cast<uint64_t>(request.buffer);
+        sqe.len       = uint32_t(request.bytes);
+        sqe.off       = request.offset;
+        sqe.user_data = slot;
+
+        sq_array_[index] = index;
+        std::atomic_ref{*sq_tail_}.store(tail + 1, std::memory_order_release);
+        pending_++;
+    }
+
+    size_t wait(std::vector<Request>& completed, size_t min_completions) override {
+        auto count = std::size(ready_);
+        completed.insert(completed.end(), ready_.begin(), ready_.end());
+        ready_.clear();
+        if (count < min_completions || pending_ > 0)
+            count += reap(min_completions > count ? min_completions - count : 0, &completed);
+        return count;
+    }
+
+    size_t getInFlight() const override {
+        return std::size(slots_) - std::size(free_) + std::size(ready_);
+    }
+
+  private:
+    UringTileIO(int fd, bool direct, int ring, const io_uring_params& params)
+      : fd_{fd}, direct_{direct}, ring_{ring}, slots_(params.sq_entries) {
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+            sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+        sq_ring_   = map(sq_ring_size_, IORING_OFF_SQ_RING);
+        cq_ring_   = params.features & IORING_FEAT_SINGLE_MMAP
+                         ? sq_ring_
+                         : map(cq_ring_size_, IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_      = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+        if (!sq_ring_ || !cq_ring_ || !sqes_)
+            return;
+
+        auto sq   = static_cast<std::byte*>(sq_ring_);
+        auto cq   = static_cast<std::byte*>(cq_ring_);
+        sq_tail_  = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_  = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head_  = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_  = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_  = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_     = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        for (auto slot = params.sq_entries; slot > 0; slot--)
+            free_.push_back(slot - 1);
+    }
+
+    void* map(size_t size, off_t offset) {
+        auto memory = mmap(
+            nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_, offset);
+        return memory == MAP_FAILED ? nullptr : memory;
+    }
+
+    // Submits pending entries and reaps completions until at least `min_completions` arrived.
+    // Completions go to `completed`, or are parked in ready_ for the next wait().
+    size_t reap(size_t min_completions, std::vector<Request>* completed = nullptr) {
+        auto count = size_t{};
+        do {
+            const auto wanted = unsigned(min_completions > count ? min_completions - count : 0);
+            if (pending_ > 0 || wanted > 0) {
+                auto result = syscall(
+                    __NR_io_uring_enter,
+                    ring_,
+                    pending_,
+                    wanted,
+                    wanted > 0 ? IORING_ENTER_GETEVENTS : 0,
+                    nullptr,
+                    0);
+                if (result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                    std::cout << "ERROR::TILE_IO::IO_URING_ENTER " << std::strerror(errno)
+                              << std::endl;
+                    return count;
+                }
+                if (result > 0)
+                    pending_ -= unsigned(result);
+            }
+
+            auto head       = *cq_head_;
+            const auto tail = std::atomic_ref{*cq_tail_}.load(std::memory_order_acquire);
+            for (; head != tail; head++) {
+                const auto& cqe = cqes_[head & *cq_mask_];
+                auto request    = slots_[cqe.user_data];
+                request.result  = cqe.res == int(request.bytes) ? int64_t(cqe.res)
+                                                               : (cqe.res < 0 ? cqe.res : -EIO);
+                free_.push_back(uint32_t(cqe.user_data));
+                (completed ? *completed : ready_).push_back(request);
+                count++;
+            }
+            std::atomic_ref{*cq_head_}.store(head, std::memory_order_release);
+        } while (count < min_completions);
+        return count;
+    }
+
+    int fd_;
+    bool direct_;
+    int ring_;
+    std::vector<Request> slots_;
+    std::vector<uint32_t> free_;
+    std::vector<Request> ready_;
+    unsigned pending_ = 0;
+
+    void* sq_ring_       = nullptr;
+    void* cq_ring_       = nullptr;
+    size_t sq_ring_size_ = 0;
+    size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_  = nullptr;
+    size_t sqes_size_    = 0;
+    unsigned* sq_tail_   = nullptr;
+    unsigned* sq_mask_   = nullptr;
+    unsigned* sq_array_  = nullptr;
+    unsigned* cq_head_   = nullptr;
+    unsigned* cq_tail_   = nullptr;
+    unsigned* cq_mask_   = nullptr;
+    io_uring_cqe* cqes_  = nullptr;
+};
+#endif
+} // namespace
+
+const char* TileIO::GetName(Backend backend) {
+    switch (backend) {
+    case Backend::Mapped:
+        return "mapped";
+    case Backend::Pread:
+        return "pread";
+    case Backend::IoUring:
+        return "io_uring";
+    }
+    return "unknown";
+}
+
+std::unique_ptr<TileIO> TileIO::Create(TileFile& file, Backend backend, bool direct) {
+#ifdef _WIN32
+    return std::make_unique<MappedTileIO>(file);
+#else
+    if (backend == Backend::Mapped)
+        return std::make_unique<MappedTileIO>(file);
+
+    auto fd = openFile(file, direct);
+    if (fd < 0 && direct) {
+        std::cout << "WARNING::TILE_IO::DIRECT_IO_UNAVAILABLE " << std::strerror(errno)
+                  << std::endl;
+        direct = false;
+        fd     = openFile(file, direct);
+    }
+    if (fd < 0) {
+        std::cout << "ERROR::TILE_IO::OPEN_FAILED " << std::strerror(errno) << std::endl;
+        return std::make_unique<MappedTileIO>(file);
+    }
+
+#ifdef TILE_IO_URING
+    if (backend == Backend::IoUring) {
+        if (auto io = UringTileIO::Create(fd, direct))
+            return io;
+        std::cout << "WARNING::TILE_IO::IO_URING_UNAVAILABLE falling back to pread" << std::endl;
+    }
+#endif
+    return std::make_unique<PreadTileIO>(fd, direct);
+#endif
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "tile_file.hpp"
+
+// Asynchronous tile reads and writes against the data section of a TileFile.
+//
+// Requests are queued with submit() and issued in batches by wait(), which blocks until at least
+// the requested number of them completed. The io_uring backend keeps a whole batch in flight at
+// once; the pread and mapped backends execute requests one at a time inside wait(). Buffers, sizes
+// and offsets must be multiples of Alignment when the file was opened for direct I/O.
+class TileIO {
+  public:
+    enum class Backend { Mapped, Pread, IoUring };
+
+    struct Request {
+        uint64_t key;
+        uint64_t offset;
+        std::byte* buffer;
+        size_t bytes;
+        bool write;
+        // Bytes transferred, or a negative errno once completed.
+        int64_t result;
+    };
+
+    static constexpr size_t Alignment = 4096;
+
+    struct BufferDeleter {
+        void operator()(std::byte* buffer) const {
+            ::operator delete[](buffer, std::align_val_t{Alignment});
+        }
+    };
+    using Buffer = std::unique_ptr<std::byte[], BufferDeleter>;
+
+    static Buffer AllocateBuffer(size_t bytes) {
+        return Buffer{new (std::align_val_t{Alignment}) std::byte[bytes]};
+    }
+
+    static const char* GetName(Backend backend);
+
+    // Falls back to Pread when io_uring or O_DIRECT is unavailable, and to Mapped off POSIX.
+    static std::unique_ptr<TileIO> Create(TileFile& file, Backend backend, bool direct = false);
+
+    virtual ~TileIO() = default;
+
+    virtual Backend getBackend() const = 0;
+    virtual bool isDirect() const { return false; }
+    virtual void submit(const Request& request) = 0;
+    virtual size_t wait(std::vector<Request>& completed, size_t min_completions) = 0;
+    virtual size_t getInFlight() const = 0;
+};
@@ -0,0 +1,141 @@
+#include "tile_prefetcher.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+// Weight of the newest sample in the exponentially smoothed velocities.
+constexpr float Smoothing = 0.3f;
+constexpr float Unwanted  = std::numeric_limits<float>::infinity();
+} // namespace
+
+TilePrefetcher::TilePrefetcher(TileCache& cache, float view_radius)
+  : cache_{cache}, view_radius_{view_radius},
+    priorities_(size_t(cache.getFile().getTilesX()) * cache.getFile().getTilesY(), Unwanted),
+    is_queued_(std::size(priorities_)) {}
+
+glm::vec2 TilePrefetcher::Focus(glm::vec3 position, float yaw, float pitch) {
+    const auto front = glm::vec3{
+        std::cos(glm::radians(yaw)) * std::cos(glm::radians(pitch)),
+        std::sin(glm::radians(pitch)),
+        std::sin(glm::radians(yaw)) * std::cos(glm::radians(pitch))};
+    auto distance = MaxFocusDistance;
+    if (front.y < 0.0f)
+        distance = std::clamp(position.y / -front.y, 0.0f, MaxFocusDistance);
+    return glm::vec2{position.x, position.z} + glm::vec2{front.x, front.z} * distance;
+}
+
+void TilePrefetcher::update(
+    float delta_time,
+    glm::vec3 camera_position,
+    float yaw,
+    float pitch,
+    glm::vec2 cursor_position,
+    float brush_radius,
+    bool stroking) {
+    const auto stats = cache_.getStats();
+    frames_++;
+    if (stats.misses > misses_)
+        stall_frames_++;
+    misses_ = stats.misses;
+
+    if (!first_ && delta_time > 0.0f) {
+        auto blend = [delta_time](auto& velocity, auto current, auto previous) {
+            velocity += ((current - previous) / delta_time - velocity) * Smoothing;
+        };
+        blend(camera_velocity_, camera_position, camera_position_);
+        blend(yaw_velocity_, yaw, yaw_);
+        blend(pitch_velocity_, pitch, pitch_);
+        blend(cursor_velocity_, cursor_position, cursor_position_);
+    }
+    first_           = false;
+    camera_position_ = camera_position;
+    yaw_             = yaw;
+    pitch_           = pitch;
+    cursor_position_ = cursor_position;
+
+    for (auto key : wanted_)
+        priorities_[index(key)] = Unwanted;
+    wanted_.clear();
+    const auto brush_margin = brush_radius + cache_.getFile().getTileSize() / 2.f;
+    for (auto step = 0; step <= Steps; step++) {
+        const auto time = Horizon * step / Steps;
+        consider(
+            Focus(
+                camera_position + camera_velocity_ * time,
+                yaw + yaw_velocity_ * time,
+                std::clamp(pitch + pitch_velocity_ * time, -89.0f, 89.0f)),
+            view_radius_,
+            time);
+        if (stroking)
+            consider(cursor_position + cursor_velocity_ * time, brush_margin, time);
+    }
+    if (!stroking)
+        consider(cursor_position, brush_margin, Horizon);
+
+    for (auto key : queued_) {
+        if (priorities_[index(key)] == Unwanted
+            && cache_.cancel(uint32_t(key), uint32_t(key >> 32)))
+            cancelled_++;
+    }
+    previous_.swap(queued_);
+    queued_.clear();
+    for (auto key : wanted_) {
+        const auto tx = uint32_t(key);
+        const auto ty = uint32_t(key >> 32);
+        if (cache_.isResident(tx, ty))
+            continue;
+        cache_.request(tx, ty, priorities_[index(key)]);
+        queued_.push_back(key);
+        if (!is_queued_[index(key)])
+            issued_++;
+    }
+    for (auto key : previous_)
+        is_queued_[index(key)] = false;
+    for (auto key : queued_)
+        is_queued_[index(key)] = true;
+}
+
+void TilePrefetcher::consider(glm::vec2 center, float radius, float time) {
+    const auto& file     = cache_.getFile();
+    const auto tile_size = float(file.getTileSize());
+    const auto x0        = std::max(0, int(std::floor((center.x - radius) / tile_size)));
+    const auto y0        = std::max(0, int(std::floor((center.y - radius) / tile_size)));
+    const auto x1        = std::min(
+        int(file.getTilesX()) - 1, int(std::floor((center.x + radius) / tile_size)));
+    const auto y1 = std::min(
+        int(file.getTilesY()) - 1, int(std::floor((center.y + radius) / tile_size)));
+
+    // Within one prediction step nearer tiles come first.
+    const auto step = Horizon / Steps;
+    for (auto ty = y0; ty <= y1; ty++) {
+        for (auto tx = x0; tx <= x1; tx++) {
+            const auto nearest = glm::clamp(
+                center, glm::vec2(tx, ty) * tile_size, glm::vec2(tx + 1, ty + 1) * tile_size);
+            const auto distance = glm::length(nearest - center);
+            if (distance > radius)
+                continue;
+            const auto key = TileKey(tx, ty);
+            auto& priority = priorities_[index(key)];
+            if (priority == Unwanted)
+                wanted_.push_back(key);
+            priority = std::min(priority, time + distance / radius * step);
+        }
+    }
+}
+
+size_t TilePrefetcher::index(uint64_t key) const {
+    return size_t(key >> 32) * cache_.getFile().getTilesX() + uint32_t(key);
+}
+
+TilePrefetcher::Stats TilePrefetcher::getStats() const {
+    const auto stats = cache_.getStats();
+    return {
+        issued_,
+        stats.prefetch_used,
+        stats.prefetch_unused,
+        cancelled_,
+        frames_,
+        stall_frames_};
+}
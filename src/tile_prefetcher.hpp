@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "tile_cache.hpp"
+
+// Queues tile loads ahead of the camera and the brush.
+//
+// Every frame the camera position, yaw and pitch and the cursor position are extrapolated from
+// their smoothed velocities over Horizon seconds. Each tile the predicted view footprint or brush
+// touches is requested with its predicted time to visibility as priority, and queued loads that
+// fell out of the prediction are cancelled. Positions are in sample space: x and z are sample
+// coordinates, y is the camera height above the ground.
+class TilePrefetcher {
+  public:
+    struct Stats {
+        uint64_t issued;
+        uint64_t used;
+        uint64_t unused;
+        uint64_t cancelled;
+        uint64_t frames;
+        // Frames that had to load at least one tile synchronously.
+        uint64_t stall_frames;
+
+        double accuracy() const {
+            const auto predictions = used + unused + cancelled;
+            return predictions ? double(used) / double(predictions) : 1.0;
+        }
+    };
+
+    static constexpr float Horizon = 0.5f;
+    static constexpr int Steps     = 5;
+    // How far ahead the camera footprint sits when it looks at or above the horizon.
+    static constexpr float MaxFocusDistance = 100.f;
+
+    TilePrefetcher(TileCache& cache, float view_radius);
+
+    // The point on the ground the camera looks at.
+    static glm::vec2 Focus(glm::vec3 position, float yaw, float pitch);
+
+    void update(
+        float delta_time,
+        glm::vec3 camera_position,
+        float yaw,
+        float pitch,
+        glm::vec2 cursor_position,
+        float brush_radius,
+        bool stroking);
+
+    Stats getStats() const;
+
+  private:
+    void consider(glm::vec2 center, float radius, float time);
+    size_t index(uint64_t key) const;
+
+    TileCache& cache_;
+    float view_radius_;
+
+    bool first_ = true;
+    glm::vec3 camera_position_{};
+    float yaw_   = 0.0f;
+    float pitch_ = 0.0f;
+    glm::vec2 cursor_position_{};
+    glm::vec3 camera_velocity_{};
+    float yaw_velocity_   = 0.0f;
+    float pitch_velocity_ = 0.0f;
+    glm::vec2 cursor_velocity_{};
+
+    // Predicted tiles of this frame and queued loads of this and the previous frame. Per tile of
+    // the map, the priority of the wanted ones, infinity for the rest, and which ones are queued.
+    // Nothing is allocated after the first frames.
+    std::vector<uint64_t> wanted_;
+    std::vector<uint64_t> queued_;
+    std::vector<uint64_t> previous_;
+    std::vector<float> priorities_;
+    std::vector<uint8_t> is_queued_;
+
+    uint64_t issued_       = 0;
+    uint64_t cancelled_    = 0;
+    uint64_t frames_       = 0;
+    uint64_t stall_frames_ = 0;
+    uint64_t misses_       = 0;
+};
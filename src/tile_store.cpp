@@ -0,0 +1,32 @@
+#include "tile_store.hpp"
+
+#include <atomic>
+
+const float* TileStore::find(uint64_t key) const {
+    auto found = tiles_.find(key);
+    return found == std::end(tiles_) ? nullptr : std::data(*found->second);
+}
+
+float* TileStore::write(uint64_t key, float fill) {
+    auto [found, inserted] = tiles_.try_emplace(key);
+    auto& tile             = found->second;
+    if (inserted) {
+        tile = std::make_shared<std::vector<float>>(tile_samples_, fill);
+    } else if (tile.use_count() > 1) {
+        tile = std::make_shared<std::vector<float>>(*tile);
+        copies_++;
+    } else {
+        // use_count() is a relaxed load. A snapshot released on another thread drops its
+        // reference with a release decrement, so this fence orders that thread's last reads of the
+        // samples before the writes below.
+        std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    return std::data(*tile);
+}
+
+TileStore::Stats TileStore::getStats() const {
+    auto shared = size_t{};
+    for (auto& [key, tile] : tiles_)
+        shared += tile.use_count() > 1;
+    return {std::size(tiles_), shared, copies_};
+}
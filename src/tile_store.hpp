@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Sparse map of reference-counted tiles with copy-on-write.
+//
+// Copying a store is a snapshot: it costs one pointer copy per tile and shares the samples. A
+// write to a tile that is still shared duplicates it first, so a snapshot stays frozen while the
+// original keeps being edited, and only tiles modified after the snapshot are ever copied. A
+// snapshot may be read on another thread; only the thread that took it writes the original.
+class TileStore {
+  public:
+    struct Stats {
+        size_t tiles;
+        // Tiles whose samples are also referenced by a live snapshot.
+        size_t shared_tiles;
+        uint64_t copies;
+    };
+
+    TileStore() = default;
+    explicit TileStore(size_t tile_samples) : tile_samples_{tile_samples} {}
+
+    // The tile's samples, or null if it was never written.
+    const float* find(uint64_t key) const;
+    // The tile's samples for writing; a new tile is filled with `fill`.
+    float* write(uint64_t key, float fill = 0.0f);
+    void erase(uint64_t key) { tiles_.erase(key); }
+    void clear() { tiles_.clear(); }
+
+    bool contains(uint64_t key) const { return tiles_.contains(key); }
+    size_t size() const { return std::size(tiles_); }
+    size_t getTileSamples() const { return tile_samples_; }
+    Stats getStats() const;
+
+    auto begin() const { return tiles_.begin(); }
+    auto end() const { return tiles_.end(); }
+
+  private:
+    size_t tile_samples_ = 0;
+    std::unordered_map<uint64_t, std::shared_ptr<std::vector<float>>> tiles_;
+    uint64_t copies_ = 0;
+};
@@ -0,0 +1,94 @@
+#include "upload_ring.hpp"
+
+#include <chrono>
+
+#include "metrics.hpp"
+#include "profiler.hpp"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr GLuint64 WaitTimeout = 1'000'000'000;
+} // namespace
+
+UploadRing::UploadRing(size_t frame_size)
+  : buffer_{Buffer::Create()}, frame_size_{frame_size} {
+    const auto size = Frames * frame_size_;
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer_.get());
+    if (GLAD_GL_VERSION_4_4 && glBufferStorage) {
+        constexpr GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_READ_BUFFER, size, nullptr, Flags);
+        mapped_ = static_cast<std::byte*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, Flags));
+    } else {
+        glBufferData(GL_COPY_READ_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+}
+
+UploadRing::~UploadRing() {
+    for (auto fence : fences_) {
+        if (fence)
+            glDeleteSync(fence);
+    }
+}
+
+void UploadRing::nextFrame() {
+    PROFILE_ZONE("UploadRing::nextFrame");
+    frames_++;
+    if (fences_[frame_])
+        glDeleteSync(fences_[frame_]);
+    fences_[frame_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame_          = (frame_ + 1) % Frames;
+    used_           = 0;
+
+    auto& fence = fences_[frame_];
+    if (!fence)
+        return;
+    if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+        static auto& waits = GlobalMetrics().histogram(
+            "upload_fence_wait_seconds", "Waits for the GPU to release a frame of the upload ring");
+
+        const auto start = Clock::now();
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, WaitTimeout)
+               == GL_TIMEOUT_EXPIRED) {
+        }
+        const auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        waits.recordSeconds(seconds);
+        fence_waits_++;
+        wait_seconds_ += seconds;
+    }
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+UploadRing::Allocation UploadRing::allocate(size_t bytes) {
+    const auto offset = (used_ + Alignment - 1) / Alignment * Alignment;
+    if (offset + bytes > frame_size_) {
+        overflows_++;
+        return {};
+    }
+    used_ = offset + bytes;
+    uploaded_bytes_ += bytes;
+
+    const auto start = frame_ * frame_size_ + offset;
+    if (mapped_)
+        return {mapped_ + start, start, bytes};
+    // The fences already keep the GPU out of this range.
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer_.get());
+    const auto data = glMapBufferRange(
+        GL_COPY_READ_BUFFER,
+        start,
+        bytes,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    return {data, start, bytes};
+}
+
+void UploadRing::commit(const Allocation& allocation) {
+    if (mapped_ || !allocation)
+        return;
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer_.get());
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+}
+
+UploadRing::Stats UploadRing::getStats() const {
+    return {mapped_ != nullptr, frames_, uploaded_bytes_, overflows_, fence_waits_, wait_seconds_};
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "gl_object.hpp"
+
+// Staging memory for uploads, written by the CPU and read by GL copies within the same frame.
+//
+// The buffer is split into one region per frame in flight. Where GL 4.4 buffer storage exists it
+// stays persistently and coherently mapped; otherwise each allocation maps its range
+// unsynchronised. Either way the driver neither copies the data nor waits for the GPU: a fence
+// after each frame's commands guards its region, and nextFrame() only waits if the GPU is still
+// Frames frames behind.
+class UploadRing {
+  public:
+    static constexpr size_t Frames           = 3;
+    static constexpr size_t DefaultFrameSize = size_t{4} << 20;
+    static constexpr size_t Alignment        = 64;
+
+    struct Allocation {
+        void* data;
+        size_t offset;
+        size_t size;
+
+        explicit operator bool() const { return data != nullptr; }
+    };
+
+    struct Stats {
+        bool persistent;
+        uint64_t frames;
+        uint64_t uploaded_bytes;
+        // Allocations that did not fit into their frame's region.
+        uint64_t overflows;
+        uint64_t fence_waits;
+        double wait_seconds;
+    };
+
+    explicit UploadRing(size_t frame_size = DefaultFrameSize);
+    UploadRing(const UploadRing&)            = delete;
+    UploadRing& operator=(const UploadRing&) = delete;
+    ~UploadRing();
+
+    // Fences the commands of the frame that ends and waits until the GPU released the region of
+    // the frame that starts.
+    void nextFrame();
+
+    // Room for `bytes` in this frame's region; empty when the region is full. The data has to be
+    // committed before GL reads it and before the next allocation.
+    Allocation allocate(size_t bytes);
+    void commit(const Allocation& allocation);
+
+    // Source of the copies, e.g. for glCopyBufferSubData or as GL_PIXEL_UNPACK_BUFFER.
+    GLuint getBuffer() const { return buffer_.get(); }
+    size_t getSize() const { return Frames * frame_size_; }
+
+    Stats getStats() const;
+
+  private:
+    Buffer buffer_;
+    size_t frame_size_;
+    std::byte* mapped_ = nullptr;
+    std::array<GLsync, Frames> fences_{};
+    size_t frame_      = 0;
+    size_t used_       = 0;
+
+    uint64_t frames_         = 0;
+    uint64_t uploaded_bytes_ = 0;
+    uint64_t overflows_      = 0;
+    uint64_t fence_waits_    = 0;
+    double wait_seconds_     = 0.0;
+};